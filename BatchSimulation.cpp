@@ -0,0 +1,223 @@
+/*******************************************************************************************
+*
+*   PacAI batched simulation
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "BatchSimulation.h"
+#include "MazeFile.h"
+#include <algorithm>
+
+template <typename T>
+static void Resize(std::vector<T> &field, int size) {
+    field.assign(size, T());
+}
+
+template <typename T>
+static void CopyColumn(const T *from, int first, T *to, int count) {
+    std::copy(from + first, from + first + count, to);
+}
+
+BatchSimulation::BatchSimulation(int numEnvironments, ThreadPool &pool) : numEnvironments(numEnvironments), pool(pool) {
+    cellSize = CELL_SIZE;
+    speed = ACTOR_SPEED;
+    tick = 0;
+
+    Simulation start;
+    start.Reset();
+    roster = start.ghosts;
+    ghostsPerEnv = roster.count;
+    int numGhosts = numEnvironments * ghostsPerEnv;
+
+    Resize(player.centroidX, numEnvironments);
+    Resize(player.centroidY, numEnvironments);
+    Resize(player.currentTileX, numEnvironments);
+    Resize(player.currentTileY, numEnvironments);
+    Resize(player.orientation, numEnvironments);
+
+    Resize(ghosts.centroidX, numGhosts);
+    Resize(ghosts.centroidY, numGhosts);
+    Resize(ghosts.currentTileX, numGhosts);
+    Resize(ghosts.currentTileY, numGhosts);
+    Resize(ghosts.orientation, numGhosts);
+    Resize(ghosts.nextTileX, numGhosts);
+    Resize(ghosts.nextTileY, numGhosts);
+    Resize(ghosts.nextNextTileX, numGhosts);
+    Resize(ghosts.nextNextTileY, numGhosts);
+    Resize(ghosts.pendingPositionX, numGhosts);
+    Resize(ghosts.pendingPositionY, numGhosts);
+    Resize(ghosts.pendingDirection, numGhosts);
+    Resize(ghosts.targetTileX, numGhosts);
+    Resize(ghosts.targetTileY, numGhosts);
+
+    Resize(ghostState, numEnvironments);
+    Resize(modePhase, numEnvironments);
+    Resize(modeTime, numEnvironments);
+    Resize(frightenedTime, numEnvironments);
+    Resize(caughtBy, numEnvironments);
+}
+
+void BatchSimulation::Reset() {
+    Simulation start;
+    start.grid = grid;
+    start.routes = routes;
+    start.board = board;
+    start.layout = layout;
+    start.Reset();
+    for (int env = 0; env < numEnvironments; env++)
+        Store(env, start);
+    tick = 0;
+}
+
+void BatchSimulation::Reset(int env) {
+    Simulation start;
+    start.grid = grid;
+    start.routes = routes;
+    start.board = board;
+    start.layout = layout;
+    start.Reset();
+    Store(env, start);
+}
+
+void BatchSimulation::Load(int env, Simulation &sim) const {
+    LoadShared(sim);
+    LoadState(env, sim);
+}
+
+void BatchSimulation::LoadShared(Simulation &sim) const {
+    sim.grid = grid;
+    sim.routes = routes;
+    sim.board = board;
+    sim.layout = layout;
+    sim.cellSize = cellSize;
+
+    Actor &p = sim.player;
+    p.width = cellSize;
+    p.height = cellSize;
+    p.speed = speed;
+
+    GhostRoster &g = sim.ghosts;
+    g.count = ghostsPerEnv;
+    g.speed = speed;
+    CopyColumn(roster.personality, 0, g.personality, ghostsPerEnv);
+    CopyColumn(roster.scatterTileX, 0, g.scatterTileX, ghostsPerEnv);
+    CopyColumn(roster.scatterTileY, 0, g.scatterTileY, ghostsPerEnv);
+    CopyColumn(roster.lead, 0, g.lead, ghostsPerEnv);
+    CopyColumn(roster.pivotScale, 0, g.pivotScale, ghostsPerEnv);
+    CopyColumn(roster.pivot, 0, g.pivot, ghostsPerEnv);
+    CopyColumn(roster.shyRadiusSquared, 0, g.shyRadiusSquared, ghostsPerEnv);
+}
+
+void BatchSimulation::LoadState(int env, Simulation &sim) const {
+    LoadScalars(env, sim);
+
+    // a game's ghosts are one contiguous run in every column //
+    GhostRoster &g = sim.ghosts;
+    int first = env * ghostsPerEnv;
+    CopyColumn(ghosts.centroidX.data(), first, g.centroidX, ghostsPerEnv);
+    CopyColumn(ghosts.centroidY.data(), first, g.centroidY, ghostsPerEnv);
+    CopyColumn(ghosts.currentTileX.data(), first, g.currentTileX, ghostsPerEnv);
+    CopyColumn(ghosts.currentTileY.data(), first, g.currentTileY, ghostsPerEnv);
+    CopyColumn(ghosts.orientation.data(), first, g.orientation, ghostsPerEnv);
+    CopyColumn(ghosts.nextTileX.data(), first, g.nextTileX, ghostsPerEnv);
+    CopyColumn(ghosts.nextTileY.data(), first, g.nextTileY, ghostsPerEnv);
+    CopyColumn(ghosts.nextNextTileX.data(), first, g.nextNextTileX, ghostsPerEnv);
+    CopyColumn(ghosts.nextNextTileY.data(), first, g.nextNextTileY, ghostsPerEnv);
+    CopyColumn(ghosts.pendingPositionX.data(), first, g.pendingPositionX, ghostsPerEnv);
+    CopyColumn(ghosts.pendingPositionY.data(), first, g.pendingPositionY, ghostsPerEnv);
+    CopyColumn(ghosts.pendingDirection.data(), first, g.pendingDirection, ghostsPerEnv);
+    CopyColumn(ghosts.targetTileX.data(), first, g.targetTileX, ghostsPerEnv);
+    CopyColumn(ghosts.targetTileY.data(), first, g.targetTileY, ghostsPerEnv);
+}
+
+void BatchSimulation::LoadScalars(int env, Simulation &sim) const {
+    sim.tick = tick;
+
+    Actor &p = sim.player;
+    p.centroid = Vector2{player.centroidX[env], player.centroidY[env]};
+    p.currentTileX = player.currentTileX[env];
+    p.currentTileY = player.currentTileY[env];
+    p.orientation = player.orientation[env];
+
+    sim.ghostState = ghostState[env];
+    sim.modePhase = modePhase[env];
+    sim.modeTime = modeTime[env];
+    sim.frightenedTime = frightenedTime[env];
+    sim.caughtBy = caughtBy[env];
+}
+
+void BatchSimulation::Store(int env, const Simulation &sim) {
+    StoreScalars(env, sim);
+
+    const GhostRoster &g = sim.ghosts;
+    int first = env * ghostsPerEnv;
+    CopyColumn(g.centroidX, 0, ghosts.centroidX.data() + first, ghostsPerEnv);
+    CopyColumn(g.centroidY, 0, ghosts.centroidY.data() + first, ghostsPerEnv);
+    CopyColumn(g.currentTileX, 0, ghosts.currentTileX.data() + first, ghostsPerEnv);
+    CopyColumn(g.currentTileY, 0, ghosts.currentTileY.data() + first, ghostsPerEnv);
+    CopyColumn(g.orientation, 0, ghosts.orientation.data() + first, ghostsPerEnv);
+    CopyColumn(g.nextTileX, 0, ghosts.nextTileX.data() + first, ghostsPerEnv);
+    CopyColumn(g.nextTileY, 0, ghosts.nextTileY.data() + first, ghostsPerEnv);
+    CopyColumn(g.nextNextTileX, 0, ghosts.nextNextTileX.data() + first, ghostsPerEnv);
+    CopyColumn(g.nextNextTileY, 0, ghosts.nextNextTileY.data() + first, ghostsPerEnv);
+    CopyColumn(g.pendingPositionX, 0, ghosts.pendingPositionX.data() + first, ghostsPerEnv);
+    CopyColumn(g.pendingPositionY, 0, ghosts.pendingPositionY.data() + first, ghostsPerEnv);
+    CopyColumn(g.pendingDirection, 0, ghosts.pendingDirection.data() + first, ghostsPerEnv);
+    CopyColumn(g.targetTileX, 0, ghosts.targetTileX.data() + first, ghostsPerEnv);
+    CopyColumn(g.targetTileY, 0, ghosts.targetTileY.data() + first, ghostsPerEnv);
+}
+
+void BatchSimulation::StoreScalars(int env, const Simulation &sim) {
+    const Actor &p = sim.player;
+    player.centroidX[env] = p.centroid.x;
+    player.centroidY[env] = p.centroid.y;
+    player.currentTileX[env] = p.currentTileX;
+    player.currentTileY[env] = p.currentTileY;
+    player.orientation[env] = p.orientation;
+
+    ghostState[env] = sim.ghostState;
+    modePhase[env] = sim.modePhase;
+    modeTime[env] = sim.modeTime;
+    frightenedTime[env] = sim.frightenedTime;
+    caughtBy[env] = sim.caughtBy;
+}
+
+GhostColumns BatchSimulation::Ghosts(int env) {
+    int first = env * ghostsPerEnv;
+    return GhostColumns{ghostsPerEnv, speed, ghosts.centroidX.data() + first, ghosts.centroidY.data() + first, ghosts.currentTileX.data() + first,
+        ghosts.currentTileY.data() + first, ghosts.orientation.data() + first, ghosts.nextTileX.data() + first, ghosts.nextTileY.data() + first,
+        ghosts.nextNextTileX.data() + first, ghosts.nextNextTileY.data() + first, ghosts.pendingPositionX.data() + first,
+        ghosts.pendingPositionY.data() + first, ghosts.pendingDirection.data() + first, ghosts.targetTileX.data() + first,
+        ghosts.targetTileY.data() + first, roster.personality, roster.scatterTileX, roster.scatterTileY, roster.lead, roster.pivotScale,
+        roster.pivot, roster.shyRadiusSquared};
+}
+
+void BatchSimulation::UseMaze(const Maze &maze) {
+    grid = &maze.grid;
+    routes = &maze.routes;
+    board = &maze.board;
+    layout = &maze.layout;
+}
+
+void BatchSimulation::Step(const Orientation *actions, float deltaTime) {
+    int grain = std::max(BATCH_MIN_GRAIN, numEnvironments / (pool.Size() * BATCH_CHUNKS_PER_WORKER));
+    pool.ParallelFor(numEnvironments, grain, [&](int begin, int end) {
+        StepRange(begin, end, actions, deltaTime);
+    });
+    tick++;
+}
+
+void BatchSimulation::StepRange(int begin, int end, const Orientation *actions, float deltaTime) {
+    // the ghosts are stepped where they lie in the columns; only the player and mode pass
+    // through the scratch Simulation, which takes what every game shares once per chunk //
+    Simulation sim;
+    LoadShared(sim);
+    for (int env = begin; env < end; env++) {
+        LoadScalars(env, sim);
+        GhostColumns columns = Ghosts(env);
+        StepSimulation(sim, columns, actions[env], deltaTime);
+        StoreScalars(env, sim);
+    }
+}
@@ -0,0 +1,106 @@
+/*******************************************************************************************
+*
+*   PacAI batched simulation
+*
+*   N independent games stored struct-of-arrays and stepped in lockstep over a ThreadPool.
+*   Each field of the per-game state in Simulation (player, ghosts, mode timer) becomes one
+*   contiguous array indexed by environment, so a chunk of games streams through cache.
+*   Every game has the same roster, so ghost fields hold ghostsPerEnv entries per game and
+*   the personality columns are kept once, in roster.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef BATCH_SIMULATION_H
+#define BATCH_SIMULATION_H
+
+#include "Simulation.h"
+#include "ThreadPool.h"
+#include <vector>
+
+// Step hands each worker about this many chunks so stealing can even out slow games, //
+// but never makes a chunk smaller than BATCH_MIN_GRAIN games //
+#define BATCH_CHUNKS_PER_WORKER 4
+#define BATCH_MIN_GRAIN 16
+
+typedef struct PlayerArrays {
+    std::vector<float> centroidX;
+    std::vector<float> centroidY;
+    std::vector<int> currentTileX;
+    std::vector<int> currentTileY;
+    std::vector<Orientation> orientation;
+} PlayerArrays;
+
+typedef struct GhostArrays {
+    std::vector<float> centroidX;
+    std::vector<float> centroidY;
+    std::vector<int> currentTileX;
+    std::vector<int> currentTileY;
+    std::vector<Orientation> orientation;
+    std::vector<int> nextTileX;
+    std::vector<int> nextTileY;
+    std::vector<int> nextNextTileX;
+    std::vector<int> nextNextTileY;
+    std::vector<float> pendingPositionX;
+    std::vector<float> pendingPositionY;
+    std::vector<Orientation> pendingDirection;
+    std::vector<int> targetTileX;
+    std::vector<int> targetTileY;
+} GhostArrays;                              // env * ghostsPerEnv + slot
+
+typedef struct BatchSimulation {
+    BatchSimulation(int numEnvironments, ThreadPool &pool);
+
+    int Size() const { return numEnvironments; }
+
+    void Reset();
+    void Reset(int env);
+
+    // actions holds one Orientation per environment //
+    void Step(const Orientation *actions, float deltaTime);
+
+    // Copies one game out into / back from the scalar layout //
+    void Load(int env, Simulation &sim) const;
+    void Store(int env, const Simulation &sim);
+
+    // The part of Load every game shares (maze, speeds, personalities); a scratch
+    // Simulation that has had this once only needs LoadState per game //
+    void LoadShared(Simulation &sim) const;
+    void LoadState(int env, Simulation &sim) const;
+
+    // One game's run of the ghost columns, to step or read in place //
+    GhostColumns Ghosts(int env);
+
+    // Every game plays the same maze; Reset() afterwards //
+    void UseMaze(const Maze &maze);
+
+    const Grid *grid = &DEFAULT_GRID;
+    const MazeRoutes *routes = &DEFAULT_MAZE_ROUTES;
+    const MazeBitboard *board = &DEFAULT_BITBOARD;
+    const MazeLayout *layout = &DEFAULT_LAYOUT;
+    float cellSize;
+    float speed;
+    PlayerArrays player;
+    GhostArrays ghosts;
+    GhostRoster roster;                     // how every game starts; only its personality columns are read
+    int ghostsPerEnv;
+    std::vector<GhostState> ghostState;
+    std::vector<int> modePhase;
+    std::vector<float> modeTime;
+    std::vector<float> frightenedTime;
+    std::vector<int> caughtBy;
+    unsigned long long tick;
+
+private:
+    void StepRange(int begin, int end, const Orientation *actions, float deltaTime);
+
+    // Everything in a game besides its ghosts //
+    void LoadScalars(int env, Simulation &sim) const;
+    void StoreScalars(int env, const Simulation &sim);
+
+    int numEnvironments;
+    ThreadPool &pool;
+} BatchSimulation;
+
+#endif
@@ -0,0 +1,86 @@
+/*******************************************************************************************
+*
+*   PacAI bitboard maze
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "Bitboard.h"
+#include <math.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+constexpr MazeBitboard DEFAULT_BITBOARD = BuildMazeBitboard(DEFAULT_GRID);
+
+bool IsTraversable(const Actor &actor, Orientation direction, float deltaTime, float cellSize, const MazeBitboard &board) {
+    if (direction == none)
+        return false;
+
+    // work along the axis of travel (0 = x, 1 = y) instead of one branch per direction //
+    const float origin[2] = { MAZE_ORIGIN_X, MAZE_ORIGIN_Y };
+    const float position[2] = { actor.centroid.x, actor.centroid.y };
+    const int limit[2] = { NUM_TILES_HORIZONTAL, NUM_TILES_VERTICAL };
+    int axis = direction >= left ? 0 : 1;
+    int other = 1 - axis;
+    int step = (direction == left || direction == up) ? -1 : 1;
+
+    int target[2] = { actor.currentTileX, actor.currentTileY };
+    target[axis] = (int)floorf((position[axis] + step * actor.speed * deltaTime - origin[axis]) / cellSize);
+
+    // verify target tile is within grid bounds and not an obstacle //
+    if ((unsigned)target[axis] >= (unsigned)limit[axis] || !board.IsWalkable(target[1], target[0]))
+        return false;
+
+    int beyond[2] = { target[0], target[1] };
+    beyond[axis] += step;
+    bool beyondWalkable = board.IsWalkable(beyond[1], beyond[0]);
+
+    bool parallel = actor.orientation == none || (actor.orientation >= left) == (direction >= left);
+    if (parallel) {
+        // if actor is approaching a barrier, we don't want it to proceed past the centroid of its target tile //
+        float centre = origin[axis] + target[axis] * cellSize + (cellSize / 2);
+        return beyondWalkable || step * (position[axis] - centre) < 0;
+    }
+
+    // if turning, only allow it once the actor is level with the target tile's centroid //
+    float centre = origin[other] + target[other] * cellSize + (cellSize / 2);
+    return fabsf(position[other] - centre) < SWEEP_EPSILON && beyondWalkable && (step > 0 || beyond[axis] > 0);
+}
+
+void LegalMoves(const MazeBitboard &board, const int *rows, const int *columns, uint8_t *moves, int count) {
+    int i = 0;
+
+#if defined(__AVX2__)
+    const int *words = (const int *)board.rows;
+    const __m256i one = _mm256_set1_epi32(1);
+    for (; i + 8 <= count; i += 8) {
+        __m256i row = _mm256_loadu_si256((const __m256i *)(rows + i));
+        __m256i column = _mm256_loadu_si256((const __m256i *)(columns + i));
+
+        // rows are stored one down, so row, row + 1 and row + 2 are the words above, at and below //
+        __m256i above = _mm256_i32gather_epi32(words, row, 4);
+        __m256i at = _mm256_i32gather_epi32(words, _mm256_add_epi32(row, one), 4);
+        __m256i below = _mm256_i32gather_epi32(words, _mm256_add_epi32(row, _mm256_set1_epi32(2)), 4);
+
+        // srlv yields zero for counts of 32 and up, so column - 1 == -1 reads as a wall //
+        __m256i exitUp = _mm256_and_si256(_mm256_srlv_epi32(above, column), one);
+        __m256i exitDown = _mm256_and_si256(_mm256_srlv_epi32(below, column), one);
+        __m256i exitLeft = _mm256_and_si256(_mm256_srlv_epi32(at, _mm256_sub_epi32(column, one)), one);
+        __m256i exitRight = _mm256_and_si256(_mm256_srlv_epi32(at, _mm256_add_epi32(column, one)), one);
+
+        __m256i mask = _mm256_or_si256(
+            _mm256_or_si256(_mm256_slli_epi32(exitUp, up), _mm256_slli_epi32(exitDown, down)),
+            _mm256_or_si256(_mm256_slli_epi32(exitLeft, left), _mm256_slli_epi32(exitRight, right)));
+
+        int lanes[8];
+        _mm256_storeu_si256((__m256i *)lanes, mask);
+        for (int k = 0; k < 8; k++)
+            moves[i + k] = (uint8_t)lanes[k];
+    }
+#endif
+
+    for (; i < count; i++)
+        moves[i] = board.LegalMoves(rows[i], columns[i]);
+}
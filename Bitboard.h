@@ -0,0 +1,63 @@
+/*******************************************************************************************
+*
+*   PacAI bitboard maze
+*
+*   The grid packed one 32-bit word per row (bit n set when column n is walkable), with a
+*   zero row above and below so neighbour lookups never need a bounds check, plus a
+*   per-tile exit mask with one bit per Orientation. The rows fit in two cache lines.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include "Simulation.h"
+#include <stdint.h>
+
+#define EXIT_UP (1 << up)
+#define EXIT_DOWN (1 << down)
+#define EXIT_LEFT (1 << left)
+#define EXIT_RIGHT (1 << right)
+
+typedef struct MazeBitboard {
+    uint32_t rows[NUM_TILES_VERTICAL + 2];                          // rows[row + 1]; first and last stay empty
+    uint8_t exits[NUM_TILES_VERTICAL][NUM_TILES_HORIZONTAL];        // EXIT_* bits for walkable neighbours
+
+    // Shifts of 32 or more (column -1 once cast to unsigned) read as a wall //
+    constexpr bool IsWalkable(int row, int column) const {
+        return (unsigned)(row + 1) < NUM_TILES_VERTICAL + 2 && (unsigned)column < 32 && ((rows[row + 1] >> column) & 1);
+    }
+
+    constexpr uint8_t LegalMoves(int row, int column) const {
+        return exits[row][column];
+    }
+} MazeBitboard;
+
+constexpr MazeBitboard BuildMazeBitboard(const Grid &grid) {
+    MazeBitboard board {};
+    for (int i = 0; i < NUM_TILES_VERTICAL; i++)
+        for (int j = 0; j < NUM_TILES_HORIZONTAL; j++)
+            if (grid[i][j] == 1)
+                board.rows[i + 1] |= 1u << j;
+
+    for (int i = 0; i < NUM_TILES_VERTICAL; i++) {
+        for (int j = 0; j < NUM_TILES_HORIZONTAL; j++) {
+            board.exits[i][j] = (board.IsWalkable(i - 1, j) << up) | (board.IsWalkable(i + 1, j) << down) |
+                                (board.IsWalkable(i, j - 1) << left) | (board.IsWalkable(i, j + 1) << right);
+        }
+    }
+    return board;
+}
+
+extern const MazeBitboard DEFAULT_BITBOARD;
+
+// Same rules as the grid version of IsTraversable, answered from the packed rows //
+bool IsTraversable(const Actor &actor, Orientation direction, float deltaTime, float cellSize, const MazeBitboard &board);
+
+// Exit masks for count tiles at once, e.g. every actor in a maze or one actor across a batch
+// of environments. Uses AVX2 gathers when the build targets it //
+void LegalMoves(const MazeBitboard &board, const int *rows, const int *columns, uint8_t *moves, int count);
+
+#endif
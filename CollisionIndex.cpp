@@ -0,0 +1,61 @@
+/*******************************************************************************************
+*
+*   PacAI collision index
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "CollisionIndex.h"
+#include <string.h>
+
+void CollisionIndex::Clear() {
+    build = 0;
+    memset(stamp, 0, sizeof(stamp));
+}
+
+void CollisionIndex::Begin(const GhostColumns &ghosts) {
+    for (int i = 0; i < ghosts.count; i++)
+        fromCell[i] = CollisionCell(ghosts.currentTileY[i], ghosts.currentTileX[i]);
+}
+
+void CollisionIndex::Build(const GhostColumns &ghosts) {
+    if (++build == 0) {
+        Clear();
+        build = 1;
+    }
+    // pushed from the top slot down, so each cell's list comes out in slot order //
+    for (int i = ghosts.count - 1; i >= 0; i--) {
+        int cell = CollisionCell(ghosts.currentTileY[i], ghosts.currentTileX[i]);
+        if (cell < 0)
+            continue;
+        if (stamp[cell] != build) {
+            stamp[cell] = build;
+            first[cell] = -1;
+        }
+        next[i] = first[cell];
+        first[cell] = i;
+    }
+}
+
+int CollisionIndex::Find(int from, int cell) const {
+    if (cell < 0)
+        return NO_COLLISION;
+    int caught = stamp[cell] == build ? first[cell] : NO_COLLISION;
+
+    // a ghost now on the tile the player left, that was on the tile the player entered //
+    if (from >= 0 && from != cell && stamp[from] == build) {
+        for (int slot = first[from]; slot >= 0; slot = next[slot]) {
+            if (fromCell[slot] == cell) {
+                caught = caught == NO_COLLISION || slot < caught ? slot : caught;
+                break;
+            }
+        }
+    }
+    return caught;
+}
+
+void CollisionIndex::Find(const int *fromCells, const int *cells, int numPlayers, int *caughtBy) const {
+    for (int p = 0; p < numPlayers; p++)
+        caughtBy[p] = Find(fromCells[p], cells[p]);
+}
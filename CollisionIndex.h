@@ -0,0 +1,52 @@
+/*******************************************************************************************
+*
+*   PacAI collision index
+*
+*   Ghosts bucketed by the tile they stand on, rebuilt each segment. A player only has to look
+*   in the buckets for its own tile and the one it just left, so checking every player against
+*   every ghost costs O(players + ghosts) however crowded the maze gets. Buckets are stamped
+*   with the build that filled them, so a rebuild never has to clear the whole grid.
+*
+*   A player is caught by a ghost on its tile, or by one it swapped tiles with during the
+*   segment, which is how a head-on pass between two tile centres shows up. That catches
+*   everything as long as no ghost crosses more than one tile per segment; Simulation::Step()
+*   keeps to that.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef COLLISION_INDEX_H
+#define COLLISION_INDEX_H
+
+#include "Simulation.h"
+
+#define COLLISION_CELLS (NUM_TILES_VERTICAL * NUM_TILES_HORIZONTAL)
+
+// Dense tile number, or -1 off the grid //
+inline int CollisionCell(int row, int column) {
+    if ((unsigned)row >= NUM_TILES_VERTICAL || (unsigned)column >= NUM_TILES_HORIZONTAL)
+        return -1;
+    return row * NUM_TILES_HORIZONTAL + column;
+}
+
+typedef struct CollisionIndex {
+    CollisionIndex() { Clear(); }
+    void Clear();
+
+    unsigned int build;                     // bumped by Build(); a cell stamped with an older one is empty
+    unsigned int stamp[COLLISION_CELLS];
+    short first[COLLISION_CELLS];           // lowest roster slot on the cell
+    short next[ROSTER_CAPACITY];            // next higher slot on the same cell, or -1
+    short fromCell[ROSTER_CAPACITY];        // each ghost's cell when the segment began
+
+    // Begin() before moving the ghosts, Build() after //
+    void Begin(const GhostColumns &ghosts);
+    void Build(const GhostColumns &ghosts);
+
+    // Lowest roster slot touching a player that moved from fromCell to cell, or NO_COLLISION //
+    int Find(int fromCell, int cell) const;
+    void Find(const int *fromCells, const int *cells, int numPlayers, int *caughtBy) const;
+} CollisionIndex;
+
+#endif
@@ -0,0 +1,411 @@
+/*******************************************************************************************
+*
+*   PacAI fixed-point simulation
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "FixedSimulation.h"
+#include "MazeTables.h"
+#include "Bitboard.h"
+#include "JunctionGraph.h"
+#include <stdlib.h>
+
+static const GhostPersonalityId FIXED_ROSTER[MAX_GHOSTS] = { BLINKY, PINKY, INKY, CLYDE };
+
+// xorshift32; never seeded with zero //
+static uint32_t NextRandom(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+FixedActor FixedActorAtTile(int row, int column, Orientation orientation) {
+    FixedActor actor;
+    actor.x = column * SUBTILE_UNITS + SUBTILE_CENTRE;
+    actor.y = row * SUBTILE_UNITS + SUBTILE_CENTRE;
+    actor.orientation = orientation;
+    return actor;
+}
+
+Vector2 FixedToScreen(const FixedActor &actor, float cellSize) {
+    return Vector2{MAZE_ORIGIN_X + actor.x * cellSize / SUBTILE_UNITS, MAZE_ORIGIN_Y + actor.y * cellSize / SUBTILE_UNITS};
+}
+
+// Units to the next tile centre along the actor's heading; a full tile when sitting on one //
+static int32_t DistanceToCentre(const FixedActor &actor) {
+    int32_t along = (actor.orientation == left || actor.orientation == right) ? actor.x : actor.y;
+    int32_t offset = (along & (SUBTILE_UNITS - 1)) - SUBTILE_CENTRE;
+    int32_t distance = (actor.orientation == left || actor.orientation == up) ? offset : -offset;
+    return distance > 0 ? distance : distance + SUBTILE_UNITS;
+}
+
+static void Advance(FixedActor &actor, int32_t distance) {
+    actor.x += MazeTablesDetail::STEP_X[actor.orientation] * distance;
+    actor.y += MazeTablesDetail::STEP_Y[actor.orientation] * distance;
+}
+
+static void MovePlayer(FixedSimulation &sim, Orientation input, int32_t remaining) {
+    FixedActor &player = sim.state.player;
+    const MazeBitboard &board = *sim.board;
+
+    // reversing never needs a junction //
+    if (input != none && player.orientation != none && input == MazeTablesDetail::OPPOSITE[player.orientation])
+        player.orientation = input;
+
+    while (remaining > 0) {
+        if (player.AtCentre()) {
+            int tile = sim.routes->Index(player.TileY(), player.TileX());
+            if (tile >= 0 && tile < MAX_PELLETS)
+                sim.state.EatPellet(tile);
+
+            uint8_t exits = board.LegalMoves(player.TileY(), player.TileX());
+            if (input != none && (exits & (1 << input)))
+                player.orientation = input;
+            else if (player.orientation == none || !(exits & (1 << player.orientation))) {
+                player.orientation = none;
+                return;
+            }
+        }
+        else if (player.orientation == none)
+            return;
+
+        int32_t step = DistanceToCentre(player);
+        step = step < remaining ? step : remaining;
+        Advance(player, step);
+        remaining -= step;
+    }
+}
+
+// What a ghost choosing a direction sees: the player, its pivot and the mode, as they stand
+// during the tick the choice falls in //
+typedef struct FixedGhostView {
+    FixedActor player;
+    FixedActor pivot;
+    GhostState ghostState;
+} FixedGhostView;
+
+// The same rules as UpdateGhostTargets(), for ghost g choosing a direction on the tile it is
+// centred on //
+static void FixedGhostTarget(const FixedSimulation &sim, int g, const FixedActor &ghost, const FixedGhostView &view, int &targetX, int &targetY) {
+    const GhostPersonality &p = GHOST_PERSONALITIES[sim.personality[g]];
+    const FixedActor &player = view.player;
+    int dx = ghost.TileX() - player.TileX();
+    int dy = ghost.TileY() - player.TileY();
+    if (view.ghostState == scatter || dx * dx + dy * dy < p.shyRadius * p.shyRadius) {
+        targetX = p.scatterTileX;
+        targetY = p.scatterTileY;
+        return;
+    }
+
+    const FixedActor &pivot = view.pivot;
+    int aheadX = player.TileX() + MazeTablesDetail::LEAD_X[player.orientation] * p.lead;
+    int aheadY = player.TileY() + MazeTablesDetail::LEAD_Y[player.orientation] * p.lead;
+    targetX = p.pivotScale * aheadX - (p.pivotScale - 1) * pivot.TileX();
+    targetY = p.pivotScale * aheadY - (p.pivotScale - 1) * pivot.TileY();
+}
+
+static Orientation ChooseFixedGhostDirection(const FixedSimulation &sim, int g, const FixedActor &ghost, const FixedGhostView &view, uint32_t &rng) {
+    uint8_t exits = sim.board->LegalMoves(ghost.TileY(), ghost.TileX());
+    uint8_t forward = exits & ~(ghost.orientation == none ? 0 : 1 << MazeTablesDetail::OPPOSITE[ghost.orientation]);
+    if (forward == 0)
+        return MazeTablesDetail::OPPOSITE[ghost.orientation];
+
+    // only real choices draw from the generator, so corridors can be skipped without it //
+    int count = __builtin_popcount(forward);
+    if (view.ghostState == frightened && count > 1) {
+        int pick = NextRandom(rng) % count;
+        for (int d = up; d <= right; d++)
+            if ((forward & (1 << d)) && pick-- == 0)
+                return (Orientation)d;
+    }
+
+    int targetX, targetY;
+    FixedGhostTarget(sim, g, ghost, view, targetX, targetY);
+    int from = sim.routes->Index(ghost.TileY(), ghost.TileX());
+    int to = sim.routes->TargetIndex(targetY, targetX);
+    return sim.routes->Route(from, to, ghost.orientation);
+}
+
+void FixedSimulation::Reset(uint32_t seed) {
+    playerSpeed = FIXED_ACTOR_SPEED;
+    ghostSpeed = FIXED_ACTOR_SPEED;
+
+    state = GameState{};
+    state.player = FixedActorAtTile(STARTING_ROW, STARTING_COLUMN, left);
+    for (int g = 0; g < MAX_GHOSTS; g++) {
+        const GhostPersonality &p = GHOST_PERSONALITIES[FIXED_ROSTER[g]];
+        personality[g] = FIXED_ROSTER[g];
+        pivot[g] = p.pivot <= g ? p.pivot : g;
+        state.ghosts[g] = FixedActorAtTile(p.startRow, p.startColumn, p.startOrientation);
+    }
+    state.numGhosts = MAX_GHOSTS;
+    state.modePhase = 0;
+    state.modeTicks = (uint16_t)(GHOST_MODE_SCHEDULE[0].seconds * FIXED_TICK_RATE);
+    state.frightenedTicks = 0;
+    state.ghostState = GHOST_MODE_SCHEDULE[0].state;
+    state.rng = seed != 0 ? seed : 0x9E3779B9u;
+    state.tick = 0;
+    for (int i = 0; i < routes->numTiles && i < MAX_PELLETS; i++)
+        state.pellets[i >> 6] |= 1ull << (i & 63);
+    int start = routes->Index(STARTING_ROW, STARTING_COLUMN);
+    if (start >= 0 && start < MAX_PELLETS)
+        state.pellets[start >> 6] &= ~(1ull << (start & 63));
+    state.hash = state.ComputeHash();
+}
+
+// The one way on from a centre with no real choice: onwards, or back out of a dead end. This
+// is what ChooseFixedGhostDirection() returns there, whatever the target //
+static Orientation ForcedGhostDirection(const MazeBitboard &board, const FixedActor &ghost) {
+    uint8_t exits = board.LegalMoves(ghost.TileY(), ghost.TileX());
+    uint8_t forward = exits & ~(ghost.orientation == none ? 0 : 1 << MazeTablesDetail::OPPOSITE[ghost.orientation]);
+    return forward != 0 ? (Orientation)__builtin_ctz(forward) : MazeTablesDetail::OPPOSITE[ghost.orientation];
+}
+
+// Moves a ghost through centres that offer no real choice; decided means it has already chosen
+// its way out of the centre it sits on //
+static void GlideGhost(const MazeBitboard &board, FixedActor &ghost, int64_t remaining, bool decided) {
+    while (remaining > 0) {
+        if (ghost.AtCentre() && !decided)
+            ghost.orientation = ForcedGhostDirection(board, ghost);
+        decided = false;
+        if (ghost.orientation == none)
+            break;
+
+        int32_t step = DistanceToCentre(ghost);
+        step = step < remaining ? step : (int32_t)remaining;
+        Advance(ghost, step);
+        remaining -= step;
+    }
+}
+
+// One tick's move, where the player and any pivot with a lower index have already moved //
+static void MoveGhost(FixedSimulation &sim, int g, int32_t remaining) {
+    FixedActor &ghost = sim.state.ghosts[g];
+    while (remaining > 0) {
+        if (ghost.AtCentre()) {
+            FixedGhostView view = {sim.state.player, sim.state.ghosts[sim.pivot[g]], sim.state.ghostState};
+            ghost.orientation = ChooseFixedGhostDirection(sim, g, ghost, view, sim.state.rng);
+        }
+        if (ghost.orientation == none)
+            break;
+
+        int32_t step = DistanceToCentre(ghost);
+        step = step < remaining ? step : remaining;
+        Advance(ghost, step);
+        remaining -= step;
+    }
+}
+
+// Units the ghost can cover before it reaches a tile centre with a real choice //
+static int64_t GhostRunway(const FixedActor &ghost, bool decided, const JunctionGraph &graph) {
+    if (ghost.orientation == none)
+        return decided ? INT32_MAX : 0;
+
+    int32_t distance = ghost.AtCentre() && !decided ? 0 : DistanceToCentre(ghost);
+    int x = (ghost.x + MazeTablesDetail::STEP_X[ghost.orientation] * distance) >> SUBTILE_SHIFT;
+    int y = (ghost.y + MazeTablesDetail::STEP_Y[ghost.orientation] * distance) >> SUBTILE_SHIFT;
+    unsigned short tiles = graph.toDecision[y][x][ghost.orientation];
+    if (tiles == NO_DECISION)
+        return INT32_MAX;
+    return distance + (int64_t)tiles * SUBTILE_UNITS;
+}
+
+// Counts ticks off the frightened clock, then off the schedule, the way Simulation's
+// AdvanceMode() counts seconds //
+static void CountDownMode(GameState &state, int32_t ticks) {
+    if (state.frightenedTicks > 0) {
+        int32_t spent = ticks < state.frightenedTicks ? ticks : state.frightenedTicks;
+        state.frightenedTicks -= spent;
+        ticks -= spent;
+        if (state.frightenedTicks > 0)
+            return;
+        state.SetGhostState(GHOST_MODE_SCHEDULE[state.modePhase].state);
+    }
+    while (ticks > 0 && GHOST_MODE_SCHEDULE[state.modePhase].seconds > 0) {
+        if (ticks < state.modeTicks) {
+            state.modeTicks -= ticks;
+            return;
+        }
+        ticks -= state.modeTicks;
+        state.modeTicks = 0;
+        if (state.modePhase + 1 >= NUM_MODE_PHASES)
+            return;
+        state.modePhase++;
+        state.modeTicks = (uint16_t)(GHOST_MODE_SCHEDULE[state.modePhase].seconds * FIXED_TICK_RATE);
+        state.SetGhostState(GHOST_MODE_SCHEDULE[state.modePhase].state);
+    }
+}
+
+// CountDownMode(), folding whatever it changes into the hash //
+static void AdvanceMode(GameState &state, int32_t ticks) {
+    uint8_t phase = state.modePhase;
+    uint16_t modeTicks = state.modeTicks;
+    uint16_t frightenedTicks = state.frightenedTicks;
+    CountDownMode(state, ticks);
+    state.UpdateModeHash(phase, modeTicks, frightenedTicks);
+}
+
+// Moves every actor a run of ticks at once. Ghosts make their choices in the order per-tick
+// stepping would: by tick, then by index, each seeing the player, its pivot and the mode as
+// they stood during that tick //
+static void MoveActors(FixedSimulation &sim, Orientation action, int32_t ticks) {
+    GameState &state = sim.state;
+    const MazeBitboard &board = *sim.board;
+    const JunctionGraph &graph = sim.junctions != NULL ? *sim.junctions : DEFAULT_JUNCTION_GRAPH;
+
+    // units covered since the start of the run, and where the next real choice lies; a ghost
+    // makes it during the first tick that reaches it with distance to spare //
+    int64_t speed = sim.ghostSpeed;
+    int64_t travelled[MAX_GHOSTS] = {};
+    int64_t junction[MAX_GHOSTS];
+    bool decided[MAX_GHOSTS] = {};
+    for (int g = 0; g < state.numGhosts; g++)
+        junction[g] = GhostRunway(state.ghosts[g], false, graph);
+
+    GameState clock;
+    int32_t playerTicks = 0;
+    int32_t clockTicks = 0;
+    while (speed > 0) {
+        int g = -1;
+        for (int i = 0; i < state.numGhosts; i++)
+            if (junction[i] < speed * ticks && (g < 0 || junction[i] / speed < junction[g] / speed))
+                g = i;
+        if (g < 0)
+            break;
+
+        int32_t tick = (int32_t)(junction[g] / speed) + 1;
+        GlideGhost(board, state.ghosts[g], junction[g] - travelled[g], decided[g]);
+        travelled[g] = junction[g];
+
+        // pellets never steer anyone, so eating them in pieces is the same as eating them per tick //
+        MovePlayer(sim, action, sim.playerSpeed * (tick - playerTicks));
+        playerTicks = tick;
+        if (tick - 1 > clockTicks) {
+            if (clockTicks == 0)
+                clock = state;
+            CountDownMode(clock, tick - 1 - clockTicks);
+            clockTicks = tick - 1;
+        }
+
+        // a pivot with a lower index has already moved this tick, a higher one has not //
+        int p = sim.pivot[g];
+        FixedGhostView view = {state.player, state.ghosts[p], clockTicks > 0 ? clock.ghostState : state.ghostState};
+        if (p != g)
+            GlideGhost(board, view.pivot, speed * (p < g ? tick : tick - 1) - travelled[p], decided[p]);
+
+        FixedActor &ghost = state.ghosts[g];
+        ghost.orientation = ChooseFixedGhostDirection(sim, g, ghost, view, state.rng);
+        decided[g] = true;
+        junction[g] = travelled[g] + GhostRunway(ghost, true, graph);
+    }
+
+    MovePlayer(sim, action, sim.playerSpeed * (ticks - playerTicks));
+    for (int g = 0; g < state.numGhosts; g++)
+        GlideGhost(board, state.ghosts[g], speed * ticks - travelled[g], decided[g]);
+}
+
+// Moves every actor ticks worth of distance and folds the changes into the hash //
+static void Advance(FixedSimulation &sim, Orientation action, int32_t ticks) {
+    GameState &state = sim.state;
+    FixedActor player = state.player;
+    FixedActor ghosts[MAX_GHOSTS];
+    for (int g = 0; g < state.numGhosts; g++)
+        ghosts[g] = state.ghosts[g];
+    uint32_t rng = state.rng;
+
+    if (ticks > 1)
+        MoveActors(sim, action, ticks);
+    else {
+        MovePlayer(sim, action, sim.playerSpeed * ticks);
+        for (int g = 0; g < state.numGhosts; g++)
+            MoveGhost(sim, g, sim.ghostSpeed * ticks);
+    }
+    state.UpdateActorHash(0, player);
+    for (int g = 0; g < state.numGhosts; g++)
+        state.UpdateActorHash(1 + g, ghosts[g]);
+    state.UpdateRngHash(rng);
+    AdvanceMode(state, ticks);
+    state.tick += ticks;
+}
+
+void FixedSimulation::Step(Orientation action) {
+    Advance(*this, action, 1);
+}
+
+uint32_t FixedSimulation::StepToEvent(Orientation action, uint32_t maxTicks) {
+    if (maxTicks == 0)
+        return 0;
+
+    // ghosts choose at junctions inside Advance() and the player turns and eats there too, so a
+    // run only has to stop before a ghost could reach the player. A player stopped on a centre
+    // the input cannot leave stays put and closes no distance //
+    const FixedActor &player = state.player;
+    bool parked = player.orientation == none && player.AtCentre() && (action == none || !(board->LegalMoves(player.TileY(), player.TileX()) & (1 << action)));
+    int32_t closing = (parked ? 0 : playerSpeed) + ghostSpeed;
+    int from = routes->Index(player.TileY(), player.TileX());
+    int32_t gap = INT32_MAX;
+    for (int g = 0; g < state.numGhosts; g++) {
+        const FixedActor &ghost = state.ghosts[g];
+
+        // a catch needs both axes within half a tile, which actors on the centre lines only get
+        // within a tile of path; the path is at least that between their tiles, less half a tile
+        // at either end //
+        int32_t apart = abs(player.x - ghost.x) > abs(player.y - ghost.y) ? abs(player.x - ghost.x) : abs(player.y - ghost.y);
+        apart -= SUBTILE_CENTRE;
+        int to = routes->Index(ghost.TileY(), ghost.TileX());
+        if (from >= 0 && to >= 0 && routes->Distance(from, to) != UNREACHABLE_DISTANCE) {
+            int32_t path = (routes->Distance(from, to) - 2) * SUBTILE_UNITS;
+            apart = path > apart ? path : apart;
+        }
+        gap = apart < gap ? apart : gap;
+    }
+    int64_t ticks = closing > 0 ? gap / closing : INT32_MAX;
+    ticks = (int64_t)maxTicks < ticks ? maxTicks : ticks;
+    int32_t fastest = playerSpeed > ghostSpeed ? playerSpeed : ghostSpeed;
+    ticks = fastest > 0 && INT32_MAX / fastest < ticks ? INT32_MAX / fastest : ticks;
+
+    if (ticks <= 0) {
+        Step(action);
+        return 1;
+    }
+
+    Advance(*this, action, (int32_t)ticks);
+    return (uint32_t)ticks;
+}
+
+// FNV-1a, a byte at a time //
+static uint64_t FoldChecksum(uint64_t hash, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        hash ^= (value >> (i * 8)) & 0xFF;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t FixedSimulation::Checksum() const {
+    // every field of the state, pellets and all ghosts included, plus the Zobrist hash so an
+    // incremental update that went wrong shows up too //
+    uint64_t hash = 14695981039346656037ull;
+    const FixedActor &player = state.player;
+    hash = FoldChecksum(hash, (uint32_t)player.x);
+    hash = FoldChecksum(hash, (uint32_t)player.y);
+    hash = FoldChecksum(hash, player.orientation);
+    for (int g = 0; g < state.numGhosts; g++) {
+        const FixedActor &ghost = state.ghosts[g];
+        hash = FoldChecksum(hash, (uint32_t)ghost.x);
+        hash = FoldChecksum(hash, (uint32_t)ghost.y);
+        hash = FoldChecksum(hash, ghost.orientation);
+    }
+    for (int w = 0; w < PELLET_WORDS; w++)
+        hash = FoldChecksum(hash, state.pellets[w]);
+    hash = FoldChecksum(hash, state.ghostState);
+    hash = FoldChecksum(hash, state.modePhase);
+    hash = FoldChecksum(hash, state.modeTicks);
+    hash = FoldChecksum(hash, state.frightenedTicks);
+    hash = FoldChecksum(hash, state.rng);
+    hash = FoldChecksum(hash, state.tick);
+    return FoldChecksum(hash, state.hash);
+}
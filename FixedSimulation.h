@@ -0,0 +1,61 @@
+/*******************************************************************************************
+*
+*   PacAI fixed-point simulation
+*
+*   Deterministic variant of Simulation. Positions are integer sub-tile units measured from
+*   the maze origin, every Step() is one fixed tick, and turns happen exactly on tile
+*   centres, so the same seed and inputs give bit-identical trajectories on any machine.
+*   Everything that changes lives in a GameState, so Snapshot() and Restore() are a copy.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef FIXED_SIMULATION_H
+#define FIXED_SIMULATION_H
+
+#include "Simulation.h"
+#include "GameState.h"
+#include <stddef.h>
+#include <stdint.h>
+
+struct JunctionGraph;
+
+#define FIXED_TICK_RATE 60                                           // ticks per simulated second
+#define FIXED_ACTOR_SPEED (ACTOR_SPEED * SUBTILE_UNITS / CELL_SIZE / FIXED_TICK_RATE)   // units per tick
+
+typedef struct FixedSimulation {
+    const MazeRoutes *routes = &DEFAULT_MAZE_ROUTES;
+    const MazeBitboard *board = &DEFAULT_BITBOARD;
+    const JunctionGraph *junctions = NULL;                          // NULL uses the stock maze's graph
+    int32_t playerSpeed;                                            // units per tick
+    int32_t ghostSpeed;
+    GhostPersonalityId personality[MAX_GHOSTS];                     // of each of state.ghosts
+    uint8_t pivot[MAX_GHOSTS];                                      // index into state.ghosts, as GhostRoster::pivot
+    GameState state;
+
+    // seed drives every random choice, currently frightened ghosts picking turns. Blinky,
+    // Pinky, Inky and Clyde start where GHOST_PERSONALITIES says and the mode schedule from
+    // its first phase. Every walkable tile but the player's starts with a pellet //
+    void Reset(uint32_t seed);
+    void Step(Orientation action);
+
+    // Jumps straight to the next event, the player and a ghost getting close enough to meet,
+    // holding action throughout and never past maxTicks. Ghost junctions, player turns and pellets
+    // are played out along the way. Returns the ticks advanced; the result is identical to calling
+    // Step() that many times //
+    uint32_t StepToEvent(Orientation action, uint32_t maxTicks);
+
+    // Hash of the full state, for comparing trajectories across runs and machines //
+    uint64_t Checksum() const;
+
+    GameState Snapshot() const { return state; }
+    void Restore(const GameState &saved) { state = saved; }
+} FixedSimulation;
+
+FixedActor FixedActorAtTile(int row, int column, Orientation orientation);
+
+// Screen position of a fixed actor, for rendering alongside the float simulation //
+Vector2 FixedToScreen(const FixedActor &actor, float cellSize);
+
+#endif
@@ -0,0 +1,124 @@
+/*******************************************************************************************
+*
+*   PacAI game state
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "GameState.h"
+#include <stdlib.h>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<GameState>::value, "GameState is copied with plain assignment");
+
+#define HASH_TILES 32                                                // covers both maze axes
+
+// Positions hash per axis as tile plus offset within it, which keeps the tables small //
+typedef struct ZobristKeys {
+    uint64_t tileX[HASH_ACTORS][HASH_TILES];
+    uint64_t offsetX[HASH_ACTORS][SUBTILE_UNITS];
+    uint64_t tileY[HASH_ACTORS][HASH_TILES];
+    uint64_t offsetY[HASH_ACTORS][SUBTILE_UNITS];
+    uint64_t orientation[HASH_ACTORS][5];
+    uint64_t pellet[MAX_PELLETS];
+    uint64_t ghostState[3];
+    uint64_t modePhase[NUM_MODE_PHASES];
+    uint64_t modeClock[HASH_CLOCK_BUCKETS];
+    uint64_t frightenedClock[HASH_CLOCK_BUCKETS];    // bucket 0 is only ever not frightened
+} ZobristKeys;
+
+// splitmix64, also used to spread the generator state over the hash //
+static uint64_t Mix(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+static ZobristKeys BuildKeys() {
+    ZobristKeys keys;
+    uint64_t *words = (uint64_t *)&keys;
+    for (size_t i = 0; i < sizeof(keys) / sizeof(uint64_t); i++)
+        words[i] = Mix(i);
+    return keys;
+}
+
+static const ZobristKeys KEYS = BuildKeys();
+
+// Clocks go in by bucket, so positions a few ticks apart still share a key but ones that reverse
+// or stop being frightened at clearly different times don't. The frightened clock rounds up,
+// which keeps its last few ticks apart from not being frightened at all //
+static int ClockBucket(uint32_t ticks) {
+    uint32_t bucket = ticks >> HASH_CLOCK_SHIFT;
+    return bucket < HASH_CLOCK_BUCKETS ? (int)bucket : HASH_CLOCK_BUCKETS - 1;
+}
+
+static uint64_t ModeKey(uint8_t phase, uint16_t modeTicks, uint16_t frightenedTicks) {
+    return KEYS.modePhase[phase] ^ KEYS.modeClock[ClockBucket(modeTicks)]
+         ^ KEYS.frightenedClock[ClockBucket(frightenedTicks + (1u << HASH_CLOCK_SHIFT) - 1)];
+}
+
+
+int GameState::PelletsLeft() const {
+    int count = 0;
+    for (int i = 0; i < PELLET_WORDS; i++)
+        count += __builtin_popcountll(pellets[i]);
+    return count;
+}
+
+void GameState::EatPellet(int index) {
+    if (!HasPellet(index))
+        return;
+    pellets[index >> 6] &= ~(1ull << (index & 63));
+    hash ^= KEYS.pellet[index];
+}
+
+bool GameState::PlayerCaught() const {
+    for (int i = 0; i < numGhosts; i++)
+        if (abs(player.x - ghosts[i].x) < SUBTILE_CENTRE && abs(player.y - ghosts[i].y) < SUBTILE_CENTRE)
+            return true;
+    return false;
+}
+
+void GameState::SetGhostState(GhostState state) {
+    hash ^= KEYS.ghostState[ghostState] ^ KEYS.ghostState[state];
+    ghostState = state;
+}
+
+static uint64_t AxisKey(const uint64_t (&tiles)[HASH_TILES], const uint64_t (&offsets)[SUBTILE_UNITS], int16_t position) {
+    return tiles[(position >> SUBTILE_SHIFT) & (HASH_TILES - 1)] ^ offsets[position & (SUBTILE_UNITS - 1)];
+}
+
+void GameState::UpdateActorHash(int slot, const FixedActor &previous) {
+    // actors move along one axis at a time, so usually only one of these runs //
+    const FixedActor &current = HashActor(slot);
+    if (current.x != previous.x)
+        hash ^= AxisKey(KEYS.tileX[slot], KEYS.offsetX[slot], previous.x) ^ AxisKey(KEYS.tileX[slot], KEYS.offsetX[slot], current.x);
+    if (current.y != previous.y)
+        hash ^= AxisKey(KEYS.tileY[slot], KEYS.offsetY[slot], previous.y) ^ AxisKey(KEYS.tileY[slot], KEYS.offsetY[slot], current.y);
+    if (current.orientation != previous.orientation)
+        hash ^= KEYS.orientation[slot][previous.orientation] ^ KEYS.orientation[slot][current.orientation];
+}
+
+void GameState::UpdateRngHash(uint32_t previous) {
+    if (rng != previous)
+        hash ^= Mix(previous) ^ Mix(rng);
+}
+
+void GameState::UpdateModeHash(uint8_t previousPhase, uint16_t previousModeTicks, uint16_t previousFrightenedTicks) {
+    uint64_t before = ModeKey(previousPhase, previousModeTicks, previousFrightenedTicks);
+    uint64_t after = ModeKey(modePhase, modeTicks, frightenedTicks);
+    hash ^= before ^ after;
+}
+
+uint64_t GameState::ComputeHash() const {
+    uint64_t result = Mix(rng) ^ KEYS.ghostState[ghostState] ^ ModeKey(modePhase, modeTicks, frightenedTicks);
+    for (int slot = 0; slot <= numGhosts; slot++)
+        result ^= AxisKey(KEYS.tileX[slot], KEYS.offsetX[slot], HashActor(slot).x) ^ AxisKey(KEYS.tileY[slot], KEYS.offsetY[slot], HashActor(slot).y)
+                ^ KEYS.orientation[slot][HashActor(slot).orientation];
+    for (int i = 0; i < MAX_PELLETS; i++)
+        if (HasPellet(i))
+            result ^= KEYS.pellet[i];
+    return result;
+}
@@ -0,0 +1,75 @@
+/*******************************************************************************************
+*
+*   PacAI game state
+*
+*   Everything that changes while a deterministic game runs, packed into two cache lines
+*   and trivially copyable, so a planner snapshots and restores a position with a plain
+*   assignment. The Zobrist hash is kept up to date as the state changes, ready to key a
+*   transposition table.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef GAME_STATE_H
+#define GAME_STATE_H
+
+#include "Simulation.h"
+#include <stdint.h>
+
+#define SUBTILE_SHIFT 8
+#define SUBTILE_UNITS (1 << SUBTILE_SHIFT)                           // units per tile
+#define SUBTILE_CENTRE (SUBTILE_UNITS / 2)
+
+#define MAX_GHOSTS 4
+#define PELLET_WORDS 5
+#define MAX_PELLETS (PELLET_WORDS * 64)                              // indexed like MazeRoutes tiles
+#define HASH_ACTORS (1 + MAX_GHOSTS)                                 // player, then each ghost
+#define HASH_CLOCK_SHIFT 4                                           // mode clocks hash in buckets of 16 ticks
+#define HASH_CLOCK_BUCKETS 128                                       // longer clocks share the last bucket
+
+typedef struct FixedActor {
+    int16_t x;                  // sub-tile units from the maze origin
+    int16_t y;
+    Orientation orientation;
+
+    int TileX() const { return x >> SUBTILE_SHIFT; }
+    int TileY() const { return y >> SUBTILE_SHIFT; }
+    bool AtCentre() const { return (x & (SUBTILE_UNITS - 1)) == SUBTILE_CENTRE && (y & (SUBTILE_UNITS - 1)) == SUBTILE_CENTRE; }
+} FixedActor;
+
+typedef struct alignas(64) GameState {
+    uint64_t hash;                          // of everything below except tick, with the mode clocks bucketed
+    uint64_t pellets[PELLET_WORDS];         // one bit per walkable tile still holding a pellet
+    FixedActor player;
+    FixedActor ghosts[MAX_GHOSTS];
+    uint8_t numGhosts;
+    GhostState ghostState;
+    uint32_t rng;
+    uint64_t tick;
+    uint16_t modeTicks;                     // left in GHOST_MODE_SCHEDULE[modePhase]
+    uint16_t frightenedTicks;               // while above 0 ghosts are frightened and the schedule waits
+    uint8_t modePhase;
+
+    bool HasPellet(int index) const { return (pellets[index >> 6] >> (index & 63)) & 1; }
+    int PelletsLeft() const;
+    void EatPellet(int index);              // no-op if already eaten
+    void SetGhostState(GhostState state);
+
+    // A ghost within half a tile of the player on both axes //
+    bool PlayerCaught() const;
+
+    // slot 0 is the player, slot 1 + i is ghosts[i]; call after changing it, passing what it
+    // was before, to fold the change into the hash //
+    const FixedActor &HashActor(int slot) const { return slot == 0 ? player : ghosts[slot - 1]; }
+    void UpdateActorHash(int slot, const FixedActor &previous);
+    void UpdateRngHash(uint32_t previous);
+    void UpdateModeHash(uint8_t previousPhase, uint16_t previousModeTicks, uint16_t previousFrightenedTicks);
+
+    // From scratch, for a freshly built state or to check the incremental one //
+    uint64_t ComputeHash() const;
+} GameState;
+
+static_assert(sizeof(GameState) <= 128, "GameState should fit in two cache lines");
+
+#endif
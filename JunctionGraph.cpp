@@ -0,0 +1,106 @@
+/*******************************************************************************************
+*
+*   PacAI junction graph
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "JunctionGraph.h"
+#include "MazeTables.h"
+
+static JunctionGraph BuildDefault() {
+    JunctionGraph graph;
+    graph.Build(DEFAULT_BITBOARD);
+    return graph;
+}
+
+const JunctionGraph DEFAULT_JUNCTION_GRAPH = BuildDefault();
+
+static int CountExits(uint8_t exits) {
+    return __builtin_popcount(exits);
+}
+
+// The heading a ghost is forced into on arriving at a tile, or none if it has a choice //
+static Orientation ForcedHeading(uint8_t exits, Orientation arrival) {
+    uint8_t forward = exits & ~(1 << MazeTablesDetail::OPPOSITE[arrival]);
+    if (CountExits(forward) >= 2)
+        return none;
+    if (forward == 0)
+        return MazeTablesDetail::OPPOSITE[arrival];
+    return (Orientation)__builtin_ctz(forward);
+}
+
+void JunctionGraph::Build(const MazeBitboard &board) {
+    // Nodes //
+    numJunctions = 0;
+    for (int i = 0; i < NUM_TILES_VERTICAL; i++) {
+        for (int j = 0; j < NUM_TILES_HORIZONTAL; j++) {
+            junctionAt[i][j] = NO_JUNCTION;
+            int exits = CountExits(board.LegalMoves(i, j));
+            if (board.IsWalkable(i, j) && exits != 2) {
+                junctionAt[i][j] = numJunctions;
+                junctionX[numJunctions] = j;
+                junctionY[numJunctions] = i;
+                numJunctions++;
+            }
+        }
+    }
+
+    // Edges: follow each exit along its corridor to the next node //
+    for (int n = 0; n < numJunctions; n++) {
+        uint8_t exits = board.LegalMoves(junctionY[n], junctionX[n]);
+        for (int d = up; d <= right; d++) {
+            JunctionEdge &edge = edges[n][d];
+            edge.to = NO_JUNCTION;
+            edge.length = 0;
+            edge.arrival = none;
+            if (!(exits & (1 << d)))
+                continue;
+
+            int x = junctionX[n] + MazeTablesDetail::STEP_X[d];
+            int y = junctionY[n] + MazeTablesDetail::STEP_Y[d];
+            Orientation heading = (Orientation)d;
+            int length = 1;
+            while (junctionAt[y][x] == NO_JUNCTION && length < MAX_JUNCTIONS) {
+                uint8_t forward = board.LegalMoves(y, x) & ~(1 << MazeTablesDetail::OPPOSITE[heading]);
+                heading = (Orientation)__builtin_ctz(forward);
+                x += MazeTablesDetail::STEP_X[heading];
+                y += MazeTablesDetail::STEP_Y[heading];
+                length++;
+            }
+            if (junctionAt[y][x] != NO_JUNCTION) {
+                edge.to = junctionAt[y][x];
+                edge.length = length;
+                edge.arrival = heading;
+            }
+        }
+    }
+
+    // Distance to the next ghost decision for every tile and arrival heading //
+    for (int i = 0; i < NUM_TILES_VERTICAL; i++) {
+        for (int j = 0; j < NUM_TILES_HORIZONTAL; j++) {
+            for (int h = up; h <= right; h++) {
+                unsigned short distance = NO_DECISION;
+                if (board.IsWalkable(i, j)) {
+                    int x = j;
+                    int y = i;
+                    Orientation heading = (Orientation)h;
+                    for (int length = 0; length < MAX_JUNCTIONS; length++) {
+                        Orientation forced = ForcedHeading(board.LegalMoves(y, x), heading);
+                        if (forced == none) {
+                            distance = length;
+                            break;
+                        }
+                        heading = forced;
+                        x += MazeTablesDetail::STEP_X[heading];
+                        y += MazeTablesDetail::STEP_Y[heading];
+                        if (!board.IsWalkable(y, x))
+                            break;
+                    }
+                }
+                toDecision[i][j][h] = distance;
+            }
+        }
+    }
+}
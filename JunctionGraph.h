@@ -0,0 +1,46 @@
+/*******************************************************************************************
+*
+*   PacAI junction graph
+*
+*   Tiles with three or more exits (and dead ends) become nodes; the corridors between them
+*   become edges weighted by their length in tiles. Alongside the graph every tile keeps,
+*   per arrival heading, how far a ghost can travel before its next real choice, which is
+*   what lets FixedSimulation::StepToEvent() skip whole corridors in one go.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef JUNCTION_GRAPH_H
+#define JUNCTION_GRAPH_H
+
+#include "Simulation.h"
+#include "Bitboard.h"
+
+#define MAX_JUNCTIONS (NUM_TILES_VERTICAL * NUM_TILES_HORIZONTAL)
+#define NO_JUNCTION -1
+#define NO_DECISION 0xFFFF                                          // corridor loops back without a junction
+
+typedef struct JunctionEdge {
+    short to;                   // NO_JUNCTION when the exit is a wall
+    unsigned short length;      // tiles from centre to centre
+    Orientation arrival;        // heading when reaching the far junction
+} JunctionEdge;
+
+typedef struct JunctionGraph {
+    int numJunctions;
+    short junctionAt[NUM_TILES_VERTICAL][NUM_TILES_HORIZONTAL];
+    unsigned char junctionX[MAX_JUNCTIONS];
+    unsigned char junctionY[MAX_JUNCTIONS];
+    JunctionEdge edges[MAX_JUNCTIONS][4];                           // by leaving Orientation
+
+    // Tiles from this tile's centre to the next centre where a ghost arriving with the given
+    // heading has more than one way forward; 0 when this tile is already such a choice //
+    unsigned short toDecision[NUM_TILES_VERTICAL][NUM_TILES_HORIZONTAL][4];
+
+    void Build(const MazeBitboard &board);
+} JunctionGraph;
+
+extern const JunctionGraph DEFAULT_JUNCTION_GRAPH;
+
+#endif
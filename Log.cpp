@@ -0,0 +1,210 @@
+/*******************************************************************************************
+*
+*   PacAI logging
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "Log.h"
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef struct LogRecord {
+    unsigned long long timestampMs;
+    unsigned char level;
+    unsigned char length;
+    char text[LOG_RECORD_TEXT];
+} LogRecord;
+
+// Single producer (the owning thread), single consumer (the writer) //
+typedef struct LogRing {
+    alignas(64) std::atomic<unsigned int> head;
+    alignas(64) std::atomic<unsigned int> tail;
+    unsigned short thread;
+    LogRecord records[LOG_RING_CAPACITY];
+} LogRing;
+
+static std::atomic<bool> running(false);
+static std::atomic<int> minLevel(LOG_MIN_LEVEL);
+static std::atomic<unsigned long long> cachedNowMs(0);
+static std::atomic<unsigned long long> dropped(0);
+
+// held while the writer drains, so a thread exiting can't free its ring underneath it //
+static std::mutex registryMutex;
+static std::vector<LogRing *> rings;
+static unsigned short nextThread = 0;
+
+static std::thread writer;
+static FILE *output = NULL;
+static LogFormat format = LOG_FORMAT_TEXT;
+
+static bool DrainRing(LogRing &ring);
+
+// Owns the calling thread's ring, and hands it back when the thread exits so pools that come
+// and go don't leave rings behind for the writer to poll //
+typedef struct LocalRing {
+    LogRing *ring = NULL;
+
+    ~LocalRing() {
+        if (ring == NULL)
+            return;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        if (running.load(std::memory_order_acquire) && DrainRing(*ring))
+            fflush(output);
+        rings.erase(std::find(rings.begin(), rings.end(), ring));
+        delete ring;
+    }
+} LocalRing;
+
+static thread_local LocalRing localRing;
+
+static unsigned long long NowMs(void) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static const char *LevelLabel(int msgType) {
+    switch (msgType)
+    {
+        case LOG_LEVEL_INFO: return "[INFO] : ";
+        case LOG_LEVEL_ERROR: return "[ERROR]: ";
+        case LOG_LEVEL_WARNING: return "[WARN] : ";
+        case LOG_LEVEL_DEBUG: return "[DEBUG]: ";
+        default: return "";
+    }
+}
+
+static LogRing *RingForThisThread(void) {
+    if (localRing.ring == NULL) {
+        LogRing *ring = new LogRing();
+        ring->head.store(0, std::memory_order_relaxed);
+        ring->tail.store(0, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+        ring->thread = nextThread++;
+        rings.push_back(ring);
+        localRing.ring = ring;
+    }
+    return localRing.ring;
+}
+
+static void WriteRecord(const LogRecord &record, unsigned short thread) {
+    if (format == LOG_FORMAT_BINARY) {
+        LogBinaryRecord header = { record.timestampMs, thread, record.level, record.length, {} };
+        fwrite(&header, sizeof(header), 1, output);
+        fwrite(record.text, 1, record.length, output);
+        return;
+    }
+
+    // strftime only runs when the second changes //
+    static unsigned long long cachedSecond = ~0ull;
+    static char timeStr[64] = { 0 };
+    unsigned long long second = record.timestampMs / 1000;
+    if (second != cachedSecond) {
+        time_t now = (time_t)second;
+        struct tm *tm_info = localtime(&now);
+        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", tm_info);
+        cachedSecond = second;
+    }
+    fprintf(output, "[%s] %s%.*s\n", timeStr, LevelLabel(record.level), (int)record.length, record.text);
+}
+
+// Call with registryMutex held //
+static bool DrainRing(LogRing &ring) {
+    unsigned int tail = ring.tail.load(std::memory_order_relaxed);
+    unsigned int head = ring.head.load(std::memory_order_acquire);
+    bool wrote = tail != head;
+    for (; tail != head; tail++)
+        WriteRecord(ring.records[tail & (LOG_RING_CAPACITY - 1)], ring.thread);
+    ring.tail.store(tail, std::memory_order_release);
+    return wrote;
+}
+
+static bool DrainRings(void) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    bool wrote = false;
+    for (LogRing *ring : rings)
+        wrote |= DrainRing(*ring);
+    return wrote;
+}
+
+static void WriterLoop(void) {
+    while (running.load(std::memory_order_acquire)) {
+        cachedNowMs.store(NowMs(), std::memory_order_relaxed);
+        if (DrainRings())
+            fflush(output);
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    DrainRings();
+    fflush(output);
+}
+
+void LogStart(FILE *file, LogFormat outputFormat) {
+    if (running.load())
+        LogStop();
+    output = file;
+    format = outputFormat;
+    cachedNowMs.store(NowMs());
+    running.store(true, std::memory_order_release);
+    writer = std::thread(WriterLoop);
+}
+
+void LogStop(void) {
+    if (!running.exchange(false))
+        return;
+    writer.join();
+}
+
+void LogSetLevel(int level) {
+    minLevel.store(level, std::memory_order_relaxed);
+}
+
+unsigned long long LogDropped(void) {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+void LogCustom(int msgType, const char *text, va_list args)
+{
+    if (msgType < minLevel.load(std::memory_order_relaxed))
+        return;
+
+    if (!running.load(std::memory_order_acquire)) {
+        char timeStr[64] = { 0 };
+        time_t now = time(NULL);
+        struct tm *tm_info = localtime(&now);
+
+        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", tm_info);
+        printf("[%s] %s", timeStr, LevelLabel(msgType));
+        vprintf(text, args);
+        printf("\n");
+        return;
+    }
+
+    LogRing *ring = RingForThisThread();
+    unsigned int head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= LOG_RING_CAPACITY) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    LogRecord &record = ring->records[head & (LOG_RING_CAPACITY - 1)];
+    int length = vsnprintf(record.text, LOG_RECORD_TEXT, text, args);
+    record.timestampMs = cachedNowMs.load(std::memory_order_relaxed);
+    record.level = (unsigned char)msgType;
+    record.length = (unsigned char)(length < 0 ? 0 : (length < LOG_RECORD_TEXT ? length : LOG_RECORD_TEXT - 1));
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void LogMessage(int msgType, const char *text, ...)
+{
+    va_list args;
+    va_start(args, text);
+    LogCustom(msgType, text, args);
+    va_end(args);
+}
@@ -0,0 +1,75 @@
+/*******************************************************************************************
+*
+*   PacAI logging
+*
+*   LOG_MESSAGE() drops anything below LOG_MIN_LEVEL at compile time, so DEBUG tracing costs
+*   nothing in release builds. Messages that survive are formatted into a lock-free ring
+*   owned by the calling thread and written out by a background thread started with
+*   LogStart(); until then they are printed synchronously, as before.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdarg.h>
+#include <stdio.h>
+
+// Values line up with raylib's TraceLogLevel so LogCustom can be installed as its callback //
+typedef enum LogLevel {
+    LOG_LEVEL_TRACE = 1,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARNING,
+    LOG_LEVEL_ERROR,
+} LogLevel;
+
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+// Arguments aren't evaluated when the level is compiled out //
+#define LOG_MESSAGE(level, ...) do { if ((level) >= LOG_MIN_LEVEL) LogMessage((level), __VA_ARGS__); } while (0)
+
+#define LOG_RING_CAPACITY 1024              // records per thread, power of two
+#define LOG_RECORD_TEXT 112                 // longer messages are truncated
+
+typedef enum LogFormat {
+    LOG_FORMAT_TEXT,                        // "[time] [LEVEL]: message" lines
+    LOG_FORMAT_BINARY,                      // LogBinaryRecord headers, each followed by its text
+} LogFormat;
+
+// Binary output: one of these per message, then `length` bytes of text with no terminator //
+typedef struct LogBinaryRecord {
+    unsigned long long timestampMs;         // milliseconds since the Unix epoch
+    unsigned short thread;
+    unsigned char level;
+    unsigned char length;
+    unsigned char reserved[4];              // always zero; spelled out so no stray padding reaches the file
+} LogBinaryRecord;
+
+static_assert(sizeof(LogBinaryRecord) == 16, "LogBinaryRecord must have no implicit padding");
+
+// Starts the background writer. output may be stdout; the writer never closes it //
+void LogStart(FILE *output, LogFormat format);
+
+// Drains every ring and stops the writer; later messages go back to being printed directly //
+void LogStop(void);
+
+// Runtime filter on top of LOG_MIN_LEVEL //
+void LogSetLevel(int minLevel);
+
+// Messages dropped because a ring was full //
+unsigned long long LogDropped(void);
+
+// Custom logging funtion
+void LogCustom(int msgType, const char *text, va_list args);
+void LogMessage(int msgType, const char *text, ...);
+
+#endif
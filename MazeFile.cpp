@@ -0,0 +1,211 @@
+/*******************************************************************************************
+*
+*   PacAI maze files
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "MazeFile.h"
+#include "Log.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_MAZE_FILE_SIZE (1 << 16)
+
+// Hands out text a line at a time without its line ending, counting lines for errors //
+typedef struct LineReader {
+    const char *next;
+    const char *end;
+    int number;
+
+    bool Read(const char *&line, int &length) {
+        if (next >= end)
+            return false;
+        line = next;
+        const char *newline = (const char *)memchr(next, '\n', end - next);
+        const char *stop = newline != NULL ? newline : end;
+        next = newline != NULL ? newline + 1 : end;
+        length = (int)(stop - line);
+        if (length > 0 && line[length - 1] == '\r')
+            length--;
+        number++;
+        return true;
+    }
+
+    // Next line that isn't blank or a comment //
+    bool ReadContent(const char *&line, int &length) {
+        while (Read(line, length))
+            if (length > 0 && line[0] != ';')
+                return true;
+        return false;
+    }
+} LineReader;
+
+// The way off the maze from an edge tile; none inside the maze or in a corner //
+static Orientation OutwardEdge(int row, int column, int rows, int columns) {
+    bool top = row == 0;
+    bool bottom = row == rows - 1;
+    bool leftEdge = column == 0;
+    bool rightEdge = column == columns - 1;
+    if (top + bottom + leftEdge + rightEdge != 1)
+        return none;
+    return top ? up : bottom ? down : leftEdge ? left : right;
+}
+
+bool ParseMaze(const char *text, size_t length, const char *name, Grid &grid, MazeLayout &layout) {
+    LineReader reader = { text, text + length, 0 };
+    const char *line;
+    int lineLength;
+
+    int columns = 0;
+    int rows = 0;
+    char header[16] = {};
+    char headerLine[64] = {};
+    if (reader.ReadContent(line, lineLength))
+        memcpy(headerLine, line, lineLength < (int)sizeof(headerLine) - 1 ? lineLength : sizeof(headerLine) - 1);
+    if (sscanf(headerLine, "%15s %d %d", header, &columns, &rows) != 3 || strcmp(header, MAZE_HEADER) != 0) {
+        LogMessage(LOG_LEVEL_ERROR, "MAZE: %s has no \"%s <columns> <rows>\" header", name, MAZE_HEADER);
+        return false;
+    }
+    if (columns < 1 || columns > NUM_TILES_HORIZONTAL || rows < 1 || rows > NUM_TILES_VERTICAL) {
+        LogMessage(LOG_LEVEL_ERROR, "MAZE: %s is %dx%d, the most is %dx%d", name, columns, rows, NUM_TILES_HORIZONTAL, NUM_TILES_VERTICAL);
+        return false;
+    }
+
+    memset(grid, 0, sizeof(Grid));
+    memset(&layout, 0, sizeof(MazeLayout));
+    layout.rows = rows;
+    layout.columns = columns;
+    int mouthAt[26][2][2];                  // [letter][end] = { row, column }
+    int mouths[26] = {};
+
+    for (int i = 0; i < rows; i++) {
+        if (!reader.ReadContent(line, lineLength)) {
+            LogMessage(LOG_LEVEL_ERROR, "MAZE: %s ends after %d of %d rows", name, i, rows);
+            return false;
+        }
+        if (lineLength != columns) {
+            LogMessage(LOG_LEVEL_ERROR, "MAZE: %s line %d has %d tiles, expected %d", name, reader.number, lineLength, columns);
+            return false;
+        }
+        for (int j = 0; j < columns; j++) {
+            char tile = line[j];
+            if (tile == '#')
+                continue;
+            grid[i][j] = 1;
+            if (tile == 'P' && layout.numPlayerSpawns < MAX_SPAWNS)
+                layout.playerSpawns[layout.numPlayerSpawns++] = Coordinate{j, i};
+            else if (tile == 'G' && layout.numGhostSpawns < MAX_SPAWNS)
+                layout.ghostSpawns[layout.numGhostSpawns++] = Coordinate{j, i};
+            else if (tile >= 'a' && tile <= 'z') {
+                int letter = tile - 'a';
+                if (mouths[letter] == 2) {
+                    LogMessage(LOG_LEVEL_ERROR, "MAZE: %s line %d: tunnel %c has more than two ends", name, reader.number, tile);
+                    return false;
+                }
+                mouthAt[letter][mouths[letter]][0] = i;
+                mouthAt[letter][mouths[letter]][1] = j;
+                mouths[letter]++;
+            }
+            else if (tile != '.' && tile != 'P' && tile != 'G') {
+                LogMessage(LOG_LEVEL_ERROR, "MAZE: %s line %d: unknown tile '%c'", name, reader.number, tile);
+                return false;
+            }
+        }
+    }
+    if (reader.ReadContent(line, lineLength)) {
+        LogMessage(LOG_LEVEL_ERROR, "MAZE: %s line %d: more rows than the header's %d", name, reader.number, rows);
+        return false;
+    }
+    if (layout.numPlayerSpawns == 0 || layout.numGhostSpawns == 0) {
+        LogMessage(LOG_LEVEL_ERROR, "MAZE: %s needs at least one P and one G", name);
+        return false;
+    }
+
+    for (int letter = 0; letter < 26; letter++) {
+        if (mouths[letter] == 0)
+            continue;
+        if (mouths[letter] != 2) {
+            LogMessage(LOG_LEVEL_ERROR, "MAZE: %s: tunnel %c has only one end", name, 'a' + letter);
+            return false;
+        }
+        int first = layout.numTunnels;
+        for (int end = 0; end < 2; end++) {
+            int row = mouthAt[letter][end][0];
+            int column = mouthAt[letter][end][1];
+            Orientation outward = OutwardEdge(row, column, rows, columns);
+            Orientation inward = outward != none ? MazeTablesDetail::OPPOSITE[outward] : none;
+            if (inward == none || grid[row + MazeTablesDetail::STEP_Y[inward]][column + MazeTablesDetail::STEP_X[inward]] != 1) {
+                LogMessage(LOG_LEVEL_ERROR, "MAZE: %s: tunnel %c at row %d column %d must be on one edge and open into the maze", name, 'a' + letter, row, column);
+                return false;
+            }
+            layout.tunnels[first + end] = MazeTunnel{row, column, outward, first + 1 - end};
+            layout.tunnelAt[row][column] = first + end + 1;
+        }
+        layout.numTunnels += 2;
+    }
+    return true;
+}
+
+// FNV-1a //
+static uint64_t HashBytes(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    return hash;
+}
+
+std::shared_ptr<const Maze> MazeCache::Parse(const char *text, size_t length, const char *name) {
+    // both are zeroed before filling, so hashing and comparing their bytes is sound //
+    Grid grid;
+    MazeLayout layout;
+    if (!ParseMaze(text, length, name, grid, layout))
+        return NULL;
+    uint64_t hash = HashBytes(HashBytes(0xCBF29CE484222325ull, grid, sizeof(Grid)), &layout, sizeof(MazeLayout));
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        std::shared_ptr<const Maze> maze = entries[i];
+        if (maze->hash == hash && memcmp(maze->grid, grid, sizeof(Grid)) == 0 && memcmp(&maze->layout, &layout, sizeof(MazeLayout)) == 0) {
+            entries.erase(entries.begin() + i);
+            entries.push_back(maze);
+            hits++;
+            LOG_MESSAGE(LOG_LEVEL_DEBUG, "MAZE: %s reuses cached tables", name);
+            return maze;
+        }
+    }
+
+    std::shared_ptr<Maze> maze = std::make_shared<Maze>();
+    memcpy(maze->grid, grid, sizeof(Grid));
+    maze->layout = layout;
+    maze->board = BuildMazeBitboard(maze->grid);
+    maze->tables.Build(maze->grid, maze->layout);
+    maze->routes = maze->tables.Routes();
+    maze->hash = hash;
+    misses++;
+    LogMessage(LOG_LEVEL_INFO, "MAZE: Loaded %s, %dx%d with %d walkable tiles and %d tunnel%s", name, layout.columns, layout.rows, maze->routes.numTiles, layout.numTunnels / 2, layout.numTunnels == 2 ? "" : "s");
+
+    if (capacity > 0) {
+        if ((int)entries.size() >= capacity)
+            entries.erase(entries.begin());
+        entries.push_back(maze);
+    }
+    return maze;
+}
+
+std::shared_ptr<const Maze> MazeCache::Load(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        LogMessage(LOG_LEVEL_ERROR, "MAZE: Could not open %s", path);
+        return NULL;
+    }
+    std::vector<char> text(MAX_MAZE_FILE_SIZE);
+    size_t length = fread(text.data(), 1, text.size(), file);
+    bool truncated = !feof(file);
+    fclose(file);
+    if (truncated) {
+        LogMessage(LOG_LEVEL_ERROR, "MAZE: %s is over %d bytes", path, MAX_MAZE_FILE_SIZE);
+        return NULL;
+    }
+    return Parse(text.data(), length, path);
+}
@@ -0,0 +1,72 @@
+/*******************************************************************************************
+*
+*   PacAI maze files
+*
+*   Mazes as plain text, one character per tile, so a new layout is a new file rather than
+*   a recompile. Lines starting with ; are comments. The first other line is the header
+*   "maze <columns> <rows>" (at most NUM_TILES_HORIZONTAL by NUM_TILES_VERTICAL) and the
+*   next rows lines are the tiles:
+*
+*       #       wall
+*       .       floor
+*       P       floor where a player starts; the first one is Simulation's
+*       G       floor where a ghost starts, in roster order; ghosts past the last one are
+*               spread over the maze
+*       a - z   floor at a tunnel mouth. Each letter marks the two ends of one tunnel, both
+*               on the maze's outer edge and neither in a corner; leaving the edge at one
+*               comes back in at the other
+*
+*   Deriving a maze's tables (bitboard, all-pairs routes) costs far more than parsing it, so
+*   MazeCache keeps them keyed by content: loading a maze seen before, from any file, hands
+*   back the same tables.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef MAZE_FILE_H
+#define MAZE_FILE_H
+
+#include "Simulation.h"
+#include "MazeTables.h"
+#include "Bitboard.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#define MAZE_HEADER "maze"
+#define MAZE_CACHE_CAPACITY 16             // each maze's tables take a few MB
+
+// A parsed maze and everything derived from it. Large, so it lives on the heap //
+typedef struct Maze {
+    Grid grid;
+    MazeLayout layout;
+    MazeBitboard board;
+    RuntimeMazeTables tables;
+    MazeRoutes routes;                      // view over tables
+    uint64_t hash;                          // of grid and layout
+} Maze;
+
+// Fills grid and layout from text; name only labels errors. False on any malformed line //
+bool ParseMaze(const char *text, size_t length, const char *name, Grid &grid, MazeLayout &layout);
+
+typedef struct MazeCache {
+    MazeCache(int capacity = MAZE_CACHE_CAPACITY) : hits(0), misses(0), capacity(capacity) {}
+
+    // NULL if the maze can't be read or parsed. A maze stays valid for as long as someone
+    // holds it, even after the cache lets it go //
+    std::shared_ptr<const Maze> Load(const char *path);
+    std::shared_ptr<const Maze> Parse(const char *text, size_t length, const char *name);
+
+    void Clear() { entries.clear(); }
+
+    unsigned long long hits;
+    unsigned long long misses;
+
+private:
+    int capacity;
+    std::vector<std::shared_ptr<const Maze>> entries;  // least recently used first
+} MazeCache;
+
+#endif
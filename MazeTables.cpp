@@ -0,0 +1,46 @@
+/*******************************************************************************************
+*
+*   PacAI maze tables
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "MazeTables.h"
+#include "Log.h"
+
+// Tables for DEFAULT_GRID, evaluated by the compiler. Each is its own constant expression
+// so no single evaluation runs into the compiler's constexpr operation limit //
+static constexpr MazeTiles<DEFAULT_MAZE_TILES> DEFAULT_MAZE_TILE_TABLE = BuildMazeTiles<DEFAULT_MAZE_TILES>(DEFAULT_GRID);
+static constexpr MazeDistances<DEFAULT_MAZE_TILES> DEFAULT_MAZE_DISTANCES = BuildMazeDistances(DEFAULT_MAZE_TILE_TABLE);
+static constexpr MazeRouteTable<DEFAULT_MAZE_TILES> DEFAULT_MAZE_ROUTE_TABLE = BuildMazeRoutes(DEFAULT_MAZE_TILE_TABLE, DEFAULT_MAZE_DISTANCES);
+
+const MazeRoutes DEFAULT_MAZE_ROUTES = RoutesOf(DEFAULT_MAZE_TILE_TABLE, DEFAULT_MAZE_DISTANCES, DEFAULT_MAZE_ROUTE_TABLE);
+
+void RuntimeMazeTables::Build(const Grid &grid) {
+    BuildMazeTiles(grid, tiles);
+    BuildMazeDistances(tiles, distances);
+    BuildMazeRoutes(tiles, distances, routes);
+}
+
+void RuntimeMazeTables::Build(const Grid &grid, const MazeLayout &layout) {
+    BuildMazeTiles(grid, tiles);
+    LinkTunnels(layout, tiles);
+    BuildMazeDistances(tiles, distances);
+    BuildMazeRoutes(tiles, distances, routes);
+}
+
+void ChooseGhostDirection(Ghost &ghost, const MazeRoutes &routes) {
+    int from = routes.Index(ghost.nextTileY, ghost.nextTileX);
+    int to = routes.TargetIndex(ghost.targetTileY, ghost.targetTileX);
+    if (from == NO_TILE || to == NO_TILE)
+        return;
+
+    Orientation choice = routes.Route(from, to, ghost.orientation);
+    if (choice == none)
+        return;
+    ghost.pendingDirection = choice;
+    ghost.nextNextTileX = ghost.nextTileX + MazeTablesDetail::STEP_X[choice];
+    ghost.nextNextTileY = ghost.nextTileY + MazeTablesDetail::STEP_Y[choice];
+    LOG_MESSAGE(LOG_LEVEL_DEBUG, "ghost at (%d, %d) heads %d towards (%d, %d)", ghost.nextTileX, ghost.nextTileY, choice, ghost.targetTileX, ghost.targetTileY);
+}
@@ -0,0 +1,271 @@
+/*******************************************************************************************
+*
+*   PacAI maze tables
+*
+*   All-pairs BFS distances and routing over the walkable tiles of a grid. Tiles are
+*   renumbered densely so the tables only cover walkable cells, and every query is a
+*   single array lookup. The stock maze's tables are generated at compile time; other
+*   grids build the same tables once at load through RuntimeMazeTables::Build().
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef MAZE_TABLES_H
+#define MAZE_TABLES_H
+
+#include "Simulation.h"
+
+#define MAX_MAZE_TILES (NUM_TILES_VERTICAL * NUM_TILES_HORIZONTAL)
+#define UNREACHABLE_DISTANCE 0xFFFF
+#define NO_TILE -1
+#define ROUTE_BITS 3
+#define ROUTE_MASK 0x7
+
+namespace MazeTablesDetail {
+
+constexpr int STEP_X[4] = { 0, 0, -1, 1 };  // indexed by Orientation: up, down, left, right
+constexpr int STEP_Y[4] = { -1, 1, 0, 0 };
+constexpr int LEAD_X[5] = { 0, 0, -1, 1, 0 };  // STEP_X and STEP_Y extended to none, which leads nowhere
+constexpr int LEAD_Y[5] = { -1, 1, 0, 0, 0 };
+constexpr Orientation PREFERENCE[4] = { up, left, down, right };
+constexpr Orientation OPPOSITE[5] = { down, up, right, left, none };
+
+constexpr int CountWalkable(const Grid &grid) {
+    int count = 0;
+    for (int i = 0; i < NUM_TILES_VERTICAL; i++)
+        for (int j = 0; j < NUM_TILES_HORIZONTAL; j++)
+            count += grid[i][j] == 1;
+    return count;
+}
+
+}
+
+#define DEFAULT_MAZE_TILES (MazeTablesDetail::CountWalkable(DEFAULT_GRID))
+
+// Dense numbering of the walkable tiles and their neighbours //
+template <int MaxTiles>
+struct MazeTiles {
+    int numTiles;
+    short tileIndex[NUM_TILES_VERTICAL][NUM_TILES_HORIZONTAL];      // dense index, NO_TILE for walls
+    short nearestTile[NUM_TILES_VERTICAL][NUM_TILES_HORIZONTAL];    // closest walkable tile, for targets inside walls
+    unsigned char tileX[MaxTiles];
+    unsigned char tileY[MaxTiles];
+    short neighbours[MaxTiles][4];                                  // by Orientation, NO_TILE if blocked
+};
+
+// Shortest path length in tiles between every pair //
+template <int MaxTiles>
+struct MazeDistances {
+    unsigned short distance[MaxTiles][MaxTiles];
+};
+
+// Best first step between every pair, with the runner-up for when the best is a reversal //
+template <int MaxTiles>
+struct MazeRouteTable {
+    unsigned char route[MaxTiles][MaxTiles];                        // best | second << ROUTE_BITS
+};
+
+template <int MaxTiles>
+constexpr void BuildMazeTiles(const Grid &grid, MazeTiles<MaxTiles> &tiles) {
+    using namespace MazeTablesDetail;
+
+    tiles.numTiles = 0;
+    for (int i = 0; i < NUM_TILES_VERTICAL; i++) {
+        for (int j = 0; j < NUM_TILES_HORIZONTAL; j++) {
+            if (grid[i][j] == 1 && tiles.numTiles < MaxTiles) {
+                tiles.tileIndex[i][j] = tiles.numTiles;
+                tiles.tileX[tiles.numTiles] = j;
+                tiles.tileY[tiles.numTiles] = i;
+                tiles.numTiles++;
+            }
+            else
+                tiles.tileIndex[i][j] = NO_TILE;
+        }
+    }
+
+    for (int t = 0; t < tiles.numTiles; t++) {
+        for (int d = 0; d < 4; d++) {
+            int row = tiles.tileY[t] + STEP_Y[d];
+            int column = tiles.tileX[t] + STEP_X[d];
+            bool inside = row >= 0 && row < NUM_TILES_VERTICAL && column >= 0 && column < NUM_TILES_HORIZONTAL;
+            tiles.neighbours[t][d] = inside ? tiles.tileIndex[row][column] : NO_TILE;
+        }
+    }
+
+    // walls take the walkable tile closest in a straight line //
+    for (int i = 0; i < NUM_TILES_VERTICAL; i++) {
+        for (int j = 0; j < NUM_TILES_HORIZONTAL; j++) {
+            int best = tiles.tileIndex[i][j];
+            if (best == NO_TILE) {
+                int bestDistance = 0;
+                for (int t = 0; t < tiles.numTiles; t++) {
+                    int dx = tiles.tileX[t] - j;
+                    int dy = tiles.tileY[t] - i;
+                    int d = dx * dx + dy * dy;
+                    if (best == NO_TILE || d < bestDistance) {
+                        best = t;
+                        bestDistance = d;
+                    }
+                }
+            }
+            tiles.nearestTile[i][j] = best;
+        }
+    }
+}
+
+// Joins each pair of tunnel mouths through the maze edge, so distances and routes take the
+// short way round. A route out of a mouth names its outward heading //
+template <int MaxTiles>
+constexpr void LinkTunnels(const MazeLayout &layout, MazeTiles<MaxTiles> &tiles) {
+    for (int i = 0; i < layout.numTunnels; i++) {
+        const MazeTunnel &mouth = layout.tunnels[i];
+        const MazeTunnel &partner = layout.tunnels[mouth.partner];
+        int from = tiles.tileIndex[mouth.row][mouth.column];
+        int to = tiles.tileIndex[partner.row][partner.column];
+        if (from != NO_TILE && to != NO_TILE)
+            tiles.neighbours[from][mouth.outward] = to;
+    }
+}
+
+template <int MaxTiles>
+constexpr void BuildMazeDistances(const MazeTiles<MaxTiles> &tiles, MazeDistances<MaxTiles> &distances) {
+    short queue[MaxTiles] = {};
+    for (int source = 0; source < tiles.numTiles; source++) {
+        unsigned short *distance = distances.distance[source];
+        for (int t = 0; t < tiles.numTiles; t++)
+            distance[t] = UNREACHABLE_DISTANCE;
+
+        int head = 0;
+        int tail = 0;
+        queue[tail++] = source;
+        distance[source] = 0;
+        while (head < tail) {
+            int current = queue[head++];
+            for (int d = 0; d < 4; d++) {
+                int neighbour = tiles.neighbours[current][d];
+                if (neighbour != NO_TILE && distance[neighbour] == UNREACHABLE_DISTANCE) {
+                    distance[neighbour] = distance[current] + 1;
+                    queue[tail++] = neighbour;
+                }
+            }
+        }
+    }
+}
+
+template <int MaxTiles>
+constexpr void BuildMazeRoutes(const MazeTiles<MaxTiles> &tiles, const MazeDistances<MaxTiles> &distances, MazeRouteTable<MaxTiles> &routes) {
+    using namespace MazeTablesDetail;
+
+    for (int from = 0; from < tiles.numTiles; from++) {
+        for (int to = 0; to < tiles.numTiles; to++) {
+            int best = none;
+            int second = none;
+            int bestDistance = UNREACHABLE_DISTANCE;
+            int secondDistance = UNREACHABLE_DISTANCE;
+            for (int k = 0; k < 4; k++) {
+                int direction = PREFERENCE[k];
+                int neighbour = tiles.neighbours[from][direction];
+                if (neighbour == NO_TILE)
+                    continue;
+                // distances are symmetric, so read along the target's row //
+                int d = distances.distance[to][neighbour];
+                if (d < bestDistance) {
+                    second = best;
+                    secondDistance = bestDistance;
+                    best = direction;
+                    bestDistance = d;
+                }
+                else if (d < secondDistance) {
+                    second = direction;
+                    secondDistance = d;
+                }
+            }
+            routes.route[from][to] = best | (second << ROUTE_BITS);
+        }
+    }
+}
+
+template <int MaxTiles>
+constexpr MazeTiles<MaxTiles> BuildMazeTiles(const Grid &grid) {
+    MazeTiles<MaxTiles> tiles {};
+    BuildMazeTiles(grid, tiles);
+    return tiles;
+}
+
+template <int MaxTiles>
+constexpr MazeDistances<MaxTiles> BuildMazeDistances(const MazeTiles<MaxTiles> &tiles) {
+    MazeDistances<MaxTiles> distances {};
+    BuildMazeDistances(tiles, distances);
+    return distances;
+}
+
+template <int MaxTiles>
+constexpr MazeRouteTable<MaxTiles> BuildMazeRoutes(const MazeTiles<MaxTiles> &tiles, const MazeDistances<MaxTiles> &distances) {
+    MazeRouteTable<MaxTiles> routes {};
+    BuildMazeRoutes(tiles, distances, routes);
+    return routes;
+}
+
+// Size-erased view over one maze's tables; this is what the simulation holds on to //
+struct MazeRoutes {
+    int numTiles;
+    int stride;
+    const short (*tileIndex)[NUM_TILES_HORIZONTAL];
+    const short (*nearestTile)[NUM_TILES_HORIZONTAL];
+    const unsigned char *tileX;
+    const unsigned char *tileY;
+    const unsigned short *distance;
+    const unsigned char *route;
+
+    int Index(int row, int column) const {
+        if (row < 0 || row >= NUM_TILES_VERTICAL || column < 0 || column >= NUM_TILES_HORIZONTAL)
+            return NO_TILE;
+        return tileIndex[row][column];
+    }
+
+    // Closest walkable tile to any (possibly off-grid) target, as ghost targets often are //
+    int TargetIndex(int row, int column) const {
+        row = row < 0 ? 0 : (row >= NUM_TILES_VERTICAL ? NUM_TILES_VERTICAL - 1 : row);
+        column = column < 0 ? 0 : (column >= NUM_TILES_HORIZONTAL ? NUM_TILES_HORIZONTAL - 1 : column);
+        return nearestTile[row][column];
+    }
+
+    int Distance(int from, int to) const {
+        return distance[from * stride + to];
+    }
+
+    // First step from one tile towards another for an actor currently heading `heading`.
+    // Reversing is never chosen unless heading is none; ties go up, left, down, right like
+    // the original ghost loop. Returns none only when the sole exit is a reversal.
+    Orientation Route(int from, int to, Orientation heading) const {
+        unsigned char packed = route[from * stride + to];
+        Orientation best = (Orientation)(packed & ROUTE_MASK);
+        return best != MazeTablesDetail::OPPOSITE[heading] ? best : (Orientation)(packed >> ROUTE_BITS);
+    }
+
+    Orientation NextHop(int from, int to) const {
+        return Route(from, to, none);
+    }
+};
+
+template <int MaxTiles>
+MazeRoutes RoutesOf(const MazeTiles<MaxTiles> &tiles, const MazeDistances<MaxTiles> &distances, const MazeRouteTable<MaxTiles> &routes) {
+    return MazeRoutes{tiles.numTiles, MaxTiles, tiles.tileIndex, tiles.nearestTile, tiles.tileX, tiles.tileY, &distances.distance[0][0], &routes.route[0][0]};
+}
+
+// Tables for grids loaded at run time, sized for a maze that is walkable everywhere //
+typedef struct RuntimeMazeTables {
+    MazeTiles<MAX_MAZE_TILES> tiles;
+    MazeDistances<MAX_MAZE_TILES> distances;
+    MazeRouteTable<MAX_MAZE_TILES> routes;
+
+    void Build(const Grid &grid);
+    void Build(const Grid &grid, const MazeLayout &layout);     // with its tunnels
+    MazeRoutes Routes() const { return RoutesOf(tiles, distances, routes); }
+} RuntimeMazeTables;
+
+// Ghost decision by maze distance: the turn to take at ghost.nextTile towards its target //
+void ChooseGhostDirection(Ghost &ghost, const MazeRoutes &routes);
+
+#endif
@@ -0,0 +1,275 @@
+/*******************************************************************************************
+*
+*   PacAI search agent
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "MctsAgent.h"
+#include "MazeTables.h"
+#include "Bitboard.h"
+#include <math.h>
+#include <stdlib.h>
+#include <chrono>
+
+static double Now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// xorshift32; never seeded with zero //
+static uint32_t NextRandom(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static Orientation PickMove(uint8_t moves, uint32_t &rng) {
+    int pick = NextRandom(rng) % __builtin_popcount(moves);
+    for (int d = up; d <= right; d++)
+        if ((moves & (1 << d)) && pick-- == 0)
+            return (Orientation)d;
+    return none;
+}
+
+// Moves that make a difference: the exits of the tile where the player next reaches a
+// centre, plus turning back, which is allowed anywhere //
+static uint8_t PlayerMoves(const FixedSimulation &sim) {
+    const FixedActor &player = sim.state.player;
+    int x = player.TileX();
+    int y = player.TileY();
+    if (!player.AtCentre() && player.orientation != none) {
+        bool horizontal = player.orientation == left || player.orientation == right;
+        int along = (horizontal ? player.x : player.y) & (SUBTILE_UNITS - 1);
+        bool passed = (player.orientation == right || player.orientation == down) ? along > SUBTILE_CENTRE : along < SUBTILE_CENTRE;
+        if (passed) {
+            x += MazeTablesDetail::STEP_X[player.orientation];
+            y += MazeTablesDetail::STEP_Y[player.orientation];
+        }
+    }
+    uint8_t moves = sim.board->LegalMoves(y, x);
+    if (player.orientation != none)
+        moves |= 1 << MazeTablesDetail::OPPOSITE[player.orientation];
+    return moves != 0 ? moves : 0xF;
+}
+
+// Holds move for one search step; terminal when the player is caught or the maze is cleared //
+static float ApplyMove(FixedSimulation &sim, Orientation move, bool &terminal) {
+    int before = sim.state.PelletsLeft();
+    for (uint32_t ticks = 0; ticks < MCTS_MOVE_TICKS; ) {
+        ticks += sim.StepToEvent(move, MCTS_MOVE_TICKS - ticks);
+        if (sim.state.PlayerCaught()) {
+            terminal = true;
+            return MCTS_CAUGHT_PENALTY;
+        }
+    }
+    int after = sim.state.PelletsLeft();
+    terminal = after == 0;
+    return (before - after) * MCTS_PELLET_REWARD;
+}
+
+MctsAgent::MctsAgent(ThreadPool &pool, double budgetSeconds) : budgetSeconds(budgetSeconds), decisions(0), lastIterations(0), lastMaxNodes(0), pool(pool), trees(pool.Size()), observed(false) {
+    for (size_t i = 0; i < trees.size(); i++) {
+        trees[i].nodes.resize(MCTS_MAX_NODES);
+        trees[i].rng = 0x9E3779B9u * (uint32_t)(i + 1);
+    }
+}
+
+void MctsAgent::Search(Tree &tree, const FixedSimulation &root, double deadline) {
+    FixedSimulation sim = root;
+    MctsNode *nodes = tree.nodes.data();
+
+    MctsNode &top = nodes[0];
+    top.state = root.state;
+    for (int d = up; d <= right; d++)
+        top.children[d] = MCTS_NO_NODE;
+    top.parent = MCTS_NO_NODE;
+    top.visits = 0;
+    top.value = 0;
+    top.reward = 0;
+    top.untried = PlayerMoves(root);
+    top.terminal = false;
+    tree.used = 1;
+    tree.iterations = 0;
+
+    while (tree.used < MCTS_MAX_NODES && ((tree.iterations & 15) != 0 || Now() < deadline)) {
+        // Selection: UCB1 down through fully expanded nodes //
+        int n = 0;
+        while (!nodes[n].terminal && nodes[n].untried == 0) {
+            float logVisits = logf((float)nodes[n].visits);
+            float bestScore = -INFINITY;
+            int best = MCTS_NO_NODE;
+            for (int d = up; d <= right; d++) {
+                int c = nodes[n].children[d];
+                if (c == MCTS_NO_NODE)
+                    continue;
+                float score = nodes[c].value / nodes[c].visits + MCTS_EXPLORATION * sqrtf(logVisits / nodes[c].visits);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = c;
+                }
+            }
+            n = best;
+        }
+
+        // Expansion //
+        if (!nodes[n].terminal) {
+            Orientation move = PickMove(nodes[n].untried, tree.rng);
+            nodes[n].untried &= ~(1 << move);
+            sim.Restore(nodes[n].state);
+            bool terminal = false;
+            float reward = ApplyMove(sim, move, terminal);
+
+            int c = tree.used++;
+            MctsNode &child = nodes[c];
+            child.state = sim.state;
+            for (int d = up; d <= right; d++)
+                child.children[d] = MCTS_NO_NODE;
+            child.parent = n;
+            child.visits = 0;
+            child.value = 0;
+            child.reward = reward;
+            child.untried = terminal ? 0 : PlayerMoves(sim);
+            child.terminal = terminal;
+            nodes[n].children[move] = c;
+            n = c;
+        }
+
+        // Rollout: random moves that only turn back at dead ends //
+        float rollout = 0;
+        if (!nodes[n].terminal) {
+            sim.Restore(nodes[n].state);
+            float discount = 1;
+            for (int i = 0; i < MCTS_ROLLOUT_MOVES; i++) {
+                uint8_t moves = PlayerMoves(sim);
+                uint8_t forward = sim.state.player.orientation == none ? moves : moves & ~(1 << MazeTablesDetail::OPPOSITE[sim.state.player.orientation]);
+                bool terminal = false;
+                rollout += discount * ApplyMove(sim, PickMove(forward != 0 ? forward : moves, tree.rng), terminal);
+                discount *= MCTS_DISCOUNT;
+                if (terminal)
+                    break;
+            }
+        }
+
+        // Backpropagation //
+        for (float value = rollout; n != MCTS_NO_NODE; n = nodes[n].parent) {
+            value = nodes[n].reward + MCTS_DISCOUNT * value;
+            nodes[n].value += value;
+            nodes[n].visits++;
+        }
+        tree.iterations++;
+    }
+}
+
+Orientation MctsAgent::Decide(const FixedSimulation &sim) {
+    double deadline = Now() + budgetSeconds;
+    pool.ParallelFor((int)trees.size(), 1, [&](int begin, int end) {
+        for (int i = begin; i < end; i++)
+            Search(trees[i], sim, deadline);
+    });
+
+    // Root parallelism: the trees vote with their root visit counts //
+    long long visits[4] = { 0, 0, 0, 0 };
+    lastIterations = 0;
+    lastMaxNodes = 0;
+    for (Tree &tree : trees) {
+        for (int d = up; d <= right; d++) {
+            int c = tree.nodes[0].children[d];
+            if (c != MCTS_NO_NODE)
+                visits[d] += tree.nodes[c].visits;
+        }
+        lastIterations += tree.iterations;
+        lastMaxNodes = tree.used > lastMaxNodes ? tree.used : lastMaxNodes;
+    }
+    decisions++;
+
+    Orientation best = sim.state.player.orientation;
+    long long bestVisits = 0;
+    for (int d = up; d <= right; d++) {
+        if (visits[d] > bestVisits) {
+            bestVisits = visits[d];
+            best = (Orientation)d;
+        }
+    }
+    return best;
+}
+
+// Sub-tile position of a float actor, pulled onto the centre line of its corridor //
+static FixedActor ToFixed(const Actor &actor, float cellSize) {
+    FixedActor fixed;
+    fixed.x = (int16_t)lroundf((actor.centroid.x - MAZE_ORIGIN_X) * SUBTILE_UNITS / cellSize);
+    fixed.y = (int16_t)lroundf((actor.centroid.y - MAZE_ORIGIN_Y) * SUBTILE_UNITS / cellSize);
+    fixed.orientation = actor.orientation;
+    if (actor.orientation != left && actor.orientation != right)
+        fixed.x = (fixed.x & ~(SUBTILE_UNITS - 1)) + SUBTILE_CENTRE;
+    if (actor.orientation != up && actor.orientation != down)
+        fixed.y = (fixed.y & ~(SUBTILE_UNITS - 1)) + SUBTILE_CENTRE;
+    return fixed;
+}
+
+FixedSimulation &MctsAgent::World() {
+    if (!observed) {
+        world.Reset(1);
+        observed = true;
+    }
+    return world;
+}
+
+void MctsAgent::Track(const Simulation &sim) {
+    GameState &state = World().state;
+    int tile = world.routes->Index(sim.player.currentTileY, sim.player.currentTileX);
+    if (tile >= 0 && tile < MAX_PELLETS)
+        state.EatPellet(tile);
+}
+
+const FixedSimulation &MctsAgent::Observe(const Simulation &sim) {
+    Track(sim);
+    GameState &state = world.state;
+    state.player = ToFixed(sim.player, sim.cellSize);
+
+    // the fixed world holds MAX_GHOSTS ghosts, so a bigger roster is cut down to the nearest,
+    // kept in roster order so each can find its pivot //
+    bool modelled[ROSTER_CAPACITY] = {};
+    for (int n = 0; n < MAX_GHOSTS && n < sim.ghosts.count; n++) {
+        int nearest = -1;
+        int nearestDistance = INT32_MAX;
+        for (int i = 0; i < sim.ghosts.count; i++) {
+            int dx = sim.ghosts.currentTileX[i] - sim.player.currentTileX;
+            int dy = sim.ghosts.currentTileY[i] - sim.player.currentTileY;
+            if (!modelled[i] && abs(dx) + abs(dy) < nearestDistance) {
+                nearest = i;
+                nearestDistance = abs(dx) + abs(dy);
+            }
+        }
+        modelled[nearest] = true;
+    }
+    int slotOf[ROSTER_CAPACITY];
+    int count = 0;
+    for (int i = 0; i < sim.ghosts.count; i++) {
+        if (!modelled[i])
+            continue;
+        Ghost ghost;
+        sim.ghosts.Load(i, ghost, sim.cellSize);
+        slotOf[i] = count;
+        world.personality[count] = (GhostPersonalityId)sim.ghosts.personality[i];
+        state.ghosts[count++] = ToFixed(ghost, sim.cellSize);
+    }
+    for (int i = 0; i < sim.ghosts.count; i++) {
+        if (modelled[i]) {
+            int pivot = sim.ghosts.pivot[i];
+            world.pivot[slotOf[i]] = (uint8_t)(modelled[pivot] ? slotOf[pivot] : slotOf[i]);
+        }
+    }
+    state.numGhosts = (uint8_t)count;
+
+    // the clocks are rounded to whole ticks; a frightened spell longer than they hold is cut short //
+    long frightenedTicks = lroundf(sim.frightenedTime * FIXED_TICK_RATE);
+    state.ghostState = sim.ghostState;
+    state.modePhase = (uint8_t)sim.modePhase;
+    state.modeTicks = (uint16_t)lroundf(sim.modeTime * FIXED_TICK_RATE);
+    state.frightenedTicks = (uint16_t)(frightenedTicks < UINT16_MAX ? frightenedTicks : UINT16_MAX);
+    state.tick = sim.tick;
+    state.hash = state.ComputeHash();
+    return world;
+}
@@ -0,0 +1,82 @@
+/*******************************************************************************************
+*
+*   PacAI search agent
+*
+*   Monte Carlo Tree Search over the deterministic simulation. Each decision grows one tree
+*   per pool worker from the same root (root parallelism) until the time budget runs out,
+*   then the root visit counts are summed and the most visited move wins. A move holds one
+*   direction for about a tile's worth of ticks; rollouts pick random legal moves.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef MCTS_AGENT_H
+#define MCTS_AGENT_H
+
+#include "FixedSimulation.h"
+#include "ThreadPool.h"
+#include <vector>
+
+#define MCTS_MAX_NODES 16384                                         // per tree; search stops growing when full
+#define MCTS_MOVE_TICKS ((SUBTILE_UNITS + FIXED_ACTOR_SPEED - 1) / FIXED_ACTOR_SPEED)
+#define MCTS_ROLLOUT_MOVES 16
+#define MCTS_DISCOUNT 0.95f
+#define MCTS_EXPLORATION 1.0f
+#define MCTS_PELLET_REWARD 1.0f
+#define MCTS_CAUGHT_PENALTY -20.0f
+#define MCTS_NO_NODE -1
+
+typedef struct MctsNode {
+    GameState state;                        // after the move that led here
+    int children[4];                        // by Orientation
+    int parent;
+    int visits;
+    float value;                            // sum of returns seen from here
+    float reward;                           // earned by the move into this node
+    uint8_t untried;                        // legal moves not expanded yet
+    bool terminal;
+} MctsNode;
+
+typedef struct MctsAgent {
+    // budgetSeconds bounds each Decide() call; the pool's workers each grow their own tree //
+    MctsAgent(ThreadPool &pool, double budgetSeconds);
+
+    Orientation Decide(const FixedSimulation &sim);
+
+    // Folds the windowed game's float state into the fixed world the search plans in: up to
+    // MAX_GHOSTS ghosts nearest the player, each with its personality, and where the mode
+    // schedule stands. Pellets are tracked here, since the float game doesn't have any yet //
+    const FixedSimulation &Observe(const Simulation &sim);
+
+    // Eats the pellet on the player's tile. Called after every Step() of the observed game, each
+    // too short to carry the player across a tile, so the pellets stay right however many ticks
+    // pass between Observe() calls //
+    void Track(const Simulation &sim);
+
+    // The observed game started over, so every pellet is back //
+    void Restart() { observed = false; }
+
+    double budgetSeconds;
+    unsigned long long decisions;
+    unsigned long long lastIterations;      // rollouts summed over every tree in the last Decide()
+    int lastMaxNodes;                       // largest tree in the last Decide()
+
+private:
+    typedef struct Tree {
+        std::vector<MctsNode> nodes;
+        int used;
+        int iterations;
+        uint32_t rng;
+    } Tree;
+
+    void Search(Tree &tree, const FixedSimulation &root, double deadline);
+    FixedSimulation &World();
+
+    ThreadPool &pool;
+    std::vector<Tree> trees;
+    FixedSimulation world;
+    bool observed;
+} MctsAgent;
+
+#endif
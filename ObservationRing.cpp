@@ -0,0 +1,183 @@
+/*******************************************************************************************
+*
+*   PacAI observation ring
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "ObservationRing.h"
+#include "MazeTables.h"
+#include "Bitboard.h"
+#include "Log.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <new>
+
+#define SLOT_SIZE ((sizeof(ObservationFrame) + OBSERVATION_PLANES * OBSERVATION_PLANE_SIZE + 63) & ~(size_t)63)
+
+static size_t MappingSize(uint32_t numSlots, uint32_t slotSize) {
+    return sizeof(ObservationRingHeader) + (size_t)numSlots * slotSize + (size_t)numSlots * sizeof(ActionSlot);
+}
+
+ObservationFrame *ObservationRing::Slot(uint64_t frame) const {
+    return (ObservationFrame *)((char *)mapping + sizeof(ObservationRingHeader) + (frame & (header->numSlots - 1)) * header->slotSize);
+}
+
+ActionSlot *ObservationRing::Action(uint64_t frame) const {
+    ActionSlot *actions = (ActionSlot *)((char *)mapping + sizeof(ObservationRingHeader) + (size_t)header->numSlots * header->slotSize);
+    return &actions[frame & (header->numSlots - 1)];
+}
+
+bool ObservationRing::Create(const char *ringName, int numSlots, const MazeBitboard &board) {
+    Close();
+    if (numSlots <= 0 || (numSlots & (numSlots - 1)) != 0) {
+        LogMessage(LOG_LEVEL_ERROR, "OBSERVATIONS: Slot count %d is not a power of two", numSlots);
+        return false;
+    }
+
+    int fd = shm_open(ringName, O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        LogMessage(LOG_LEVEL_ERROR, "OBSERVATIONS: Could not create %s", ringName);
+        return false;
+    }
+    size_t size = MappingSize(numSlots, SLOT_SIZE);
+    void *memory = ftruncate(fd, size) == 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(ringName);
+        LogMessage(LOG_LEVEL_ERROR, "OBSERVATIONS: Could not map %zu bytes for %s", size, ringName);
+        return false;
+    }
+
+    mapping = memory;
+    mappingSize = size;
+    owner = true;
+    strncpy(name, ringName, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    memset(mapping, 0, size);
+
+    header = new (mapping) ObservationRingHeader();
+    header->numSlots = numSlots;
+    header->slotSize = SLOT_SIZE;
+    header->planes = OBSERVATION_PLANES;
+    header->rows = NUM_TILES_VERTICAL;
+    header->columns = NUM_TILES_HORIZONTAL;
+    header->published.store(0, std::memory_order_relaxed);
+    header->consumed.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < numSlots; i++)
+        new (Action(i)) ActionSlot();
+
+    // Walls never change, so every slot gets its plane now and Publish() skips it //
+    for (int i = 0; i < numSlots; i++) {
+        uint8_t *walls = Slot(i)->Planes() + PLANE_WALLS * OBSERVATION_PLANE_SIZE;
+        for (int row = 0; row < NUM_TILES_VERTICAL; row++)
+            for (int column = 0; column < NUM_TILES_HORIZONTAL; column++)
+                walls[row * NUM_TILES_HORIZONTAL + column] = !board.IsWalkable(row, column);
+    }
+
+    // Written last, so a trainer that sees the magic sees the rest //
+    header->version = OBSERVATION_VERSION;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = OBSERVATION_MAGIC;
+    lastPellets = -1;
+    LogMessage(LOG_LEVEL_INFO, "OBSERVATIONS: Created %s with %d slots of %u bytes", name, numSlots, header->slotSize);
+    return true;
+}
+
+bool ObservationRing::Attach(const char *ringName) {
+    Close();
+    int fd = shm_open(ringName, O_RDWR, 0600);
+    if (fd < 0)
+        return false;
+    ObservationRingHeader probe;
+    bool valid = pread(fd, &probe, sizeof(probe), 0) == (ssize_t)sizeof(probe) && probe.magic == OBSERVATION_MAGIC && probe.version == OBSERVATION_VERSION;
+    size_t size = valid ? MappingSize(probe.numSlots, probe.slotSize) : 0;
+    void *memory = valid ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (memory == MAP_FAILED)
+        return false;
+
+    mapping = memory;
+    mappingSize = size;
+    owner = false;
+    header = (ObservationRingHeader *)mapping;
+    return true;
+}
+
+void ObservationRing::Close() {
+    if (mapping == NULL)
+        return;
+    munmap(mapping, mappingSize);
+    if (owner)
+        shm_unlink(name);
+    mapping = NULL;
+    header = NULL;
+}
+
+bool ObservationRing::Publish(const FixedSimulation &sim, bool done) {
+    uint64_t frame = header->published.load(std::memory_order_relaxed);
+    if (frame - header->consumed.load(std::memory_order_acquire) >= header->numSlots)
+        return false;
+
+    const GameState &state = sim.state;
+    int pellets = state.PelletsLeft();
+    ObservationFrame *slot = Slot(frame);
+    slot->frame = frame;
+    slot->tick = state.tick;
+    slot->hash = state.hash;
+    slot->reward = lastPellets >= pellets ? (float)(lastPellets - pellets) : 0;
+    slot->done = done;
+    slot->ghostState = state.ghostState;
+    slot->numGhosts = state.numGhosts;
+    slot->playerOrientation = state.player.orientation;
+    slot->playerTileX = state.player.TileX();
+    slot->playerTileY = state.player.TileY();
+    lastPellets = done ? -1 : pellets;
+
+    uint8_t *planes = slot->Planes();
+    memset(planes + PLANE_PLAYER * OBSERVATION_PLANE_SIZE, 0, (PLANE_GHOST_STATE - PLANE_PLAYER) * OBSERVATION_PLANE_SIZE);
+    planes[PLANE_PLAYER * OBSERVATION_PLANE_SIZE + state.player.TileY() * NUM_TILES_HORIZONTAL + state.player.TileX()] = 1;
+
+    uint8_t *pelletPlane = planes + PLANE_PELLETS * OBSERVATION_PLANE_SIZE;
+    const MazeRoutes &routes = *sim.routes;
+    for (int i = 0; i < routes.numTiles && i < MAX_PELLETS; i++)
+        if (state.HasPellet(i))
+            pelletPlane[routes.tileY[i] * NUM_TILES_HORIZONTAL + routes.tileX[i]] = 1;
+
+    for (int g = 0; g < state.numGhosts; g++) {
+        int cell = state.ghosts[g].TileY() * NUM_TILES_HORIZONTAL + state.ghosts[g].TileX();
+        planes[(PLANE_GHOSTS + g) * OBSERVATION_PLANE_SIZE + cell] = 1;
+        planes[(PLANE_GHOST_HEADINGS + g) * OBSERVATION_PLANE_SIZE + cell] = state.ghosts[g].orientation + 1;
+    }
+    memset(planes + PLANE_GHOST_STATE * OBSERVATION_PLANE_SIZE, state.ghostState + 1, OBSERVATION_PLANE_SIZE);
+
+    header->published.store(frame + 1, std::memory_order_release);
+    return true;
+}
+
+int ObservationRing::PollAction(uint64_t frame) const {
+    const ActionSlot *slot = Action(frame);
+    if (slot->frame.load(std::memory_order_acquire) != frame + 1)
+        return NO_ACTION;
+    return slot->action;
+}
+
+const ObservationFrame *ObservationRing::Next() const {
+    uint64_t frame = header->consumed.load(std::memory_order_relaxed);
+    if (frame == header->published.load(std::memory_order_acquire))
+        return NULL;
+    return Slot(frame);
+}
+
+void ObservationRing::SendAction(uint64_t frame, Orientation action) {
+    ActionSlot *slot = Action(frame);
+    slot->action = action;
+    slot->frame.store(frame + 1, std::memory_order_release);
+}
+
+void ObservationRing::Release() {
+    header->consumed.fetch_add(1, std::memory_order_release);
+}
@@ -0,0 +1,110 @@
+/*******************************************************************************************
+*
+*   PacAI observation ring
+*
+*   Shared-memory hand-off to an external trainer. The simulation publishes one frame per
+*   step into a fixed ring of slots, each a 64 byte header followed by uint8 feature planes
+*   of NUM_TILES_VERTICAL x NUM_TILES_HORIZONTAL, and the trainer answers each frame through
+*   a matching ring of action slots. Both sides only ever touch the mapping in place; the
+*   indices are lock-free atomics, so nothing is copied, serialised or allocated per step.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef OBSERVATION_RING_H
+#define OBSERVATION_RING_H
+
+#include "FixedSimulation.h"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#define OBSERVATION_MAGIC 0x4F434150u       // "PACO"
+#define OBSERVATION_VERSION 1
+#define OBSERVATION_DEFAULT_NAME "/pacai-observations"
+#define OBSERVATION_DEFAULT_SLOTS 64        // power of two
+#define OBSERVATION_PLANE_SIZE (NUM_TILES_VERTICAL * NUM_TILES_HORIZONTAL)
+#define NO_ACTION -1
+
+// Feature planes, in slot order. Cells are 0 or 1 unless noted //
+typedef enum ObservationPlane {
+    PLANE_WALLS,                            // written once when the ring is created
+    PLANE_PLAYER,
+    PLANE_PELLETS,
+    PLANE_GHOSTS,                           // MAX_GHOSTS planes, one per ghost slot
+    PLANE_GHOST_HEADINGS = PLANE_GHOSTS + MAX_GHOSTS,   // Orientation + 1 on each ghost's tile
+    PLANE_GHOST_STATE = PLANE_GHOST_HEADINGS + MAX_GHOSTS,  // GhostState + 1 everywhere
+    OBSERVATION_PLANES
+} ObservationPlane;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring indices must be lock-free to work across processes");
+
+typedef struct alignas(64) ObservationFrame {
+    uint64_t frame;                         // sequence number, from 0
+    uint64_t tick;
+    uint64_t hash;                          // GameState::hash
+    float reward;                           // pellets eaten since the previous frame
+    uint8_t done;                           // caught or cleared; the next frame starts a new game
+    uint8_t ghostState;
+    uint8_t numGhosts;
+    uint8_t playerOrientation;
+    int16_t playerTileX;
+    int16_t playerTileY;
+
+    uint8_t *Planes() { return (uint8_t *)(this + 1); }
+    const uint8_t *Planes() const { return (const uint8_t *)(this + 1); }
+    const uint8_t *Plane(int plane) const { return Planes() + plane * OBSERVATION_PLANE_SIZE; }
+} ObservationFrame;
+
+typedef struct alignas(64) ActionSlot {
+    std::atomic<uint64_t> frame;            // frame + 1 once action answers it
+    int32_t action;
+} ActionSlot;
+
+// Lives at offset 0 of the mapping; the frame slots follow it, then the action slots //
+typedef struct alignas(64) ObservationRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numSlots;
+    uint32_t slotSize;                      // bytes per frame slot, header included
+    uint32_t planes;
+    uint32_t rows;
+    uint32_t columns;
+    alignas(64) std::atomic<uint64_t> published;    // frames written so far
+    alignas(64) std::atomic<uint64_t> consumed;     // frames the trainer has released
+} ObservationRingHeader;
+
+// Either end of the ring: the simulation creates it, the trainer attaches to it //
+typedef struct ObservationRing {
+    ObservationRing() : header(NULL), mapping(NULL), mappingSize(0), owner(false), lastPellets(0) {}
+    ~ObservationRing() { Close(); }
+
+    bool Create(const char *name, int numSlots, const MazeBitboard &board);
+    bool Attach(const char *name);
+    void Close();
+
+    // Producer. Returns false without writing when the trainer is a full ring behind //
+    bool Publish(const FixedSimulation &sim, bool done);
+    // Answer to the given frame, or NO_ACTION if the trainer hasn't sent it yet //
+    int PollAction(uint64_t frame) const;
+
+    // Consumer. Next() points into the shared slot, valid until Release() //
+    const ObservationFrame *Next() const;
+    void SendAction(uint64_t frame, Orientation action);
+    void Release();
+
+    ObservationRingHeader *header;
+
+private:
+    ObservationFrame *Slot(uint64_t frame) const;
+    ActionSlot *Action(uint64_t frame) const;
+
+    void *mapping;
+    size_t mappingSize;
+    bool owner;
+    char name[64];
+    int lastPellets;
+} ObservationRing;
+
+#endif
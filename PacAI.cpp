@@ -10,341 +10,212 @@
 ********************************************************************************************/
 
 #include "raylib.h"
-#include "raymath.h" 
-#include "math.h"
-#include <stdio.h>
-#include <time.h>
-#include <string>
-#include <limits>
+#include "Simulation.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "SpriteAtlas.h"
+#include "MctsAgent.h"
+#include "MazeFile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
 
 #define SCREEN_WIDTH 800
 #define SCREEN_HEIGHT 900
-#define MAZE_ORIGIN_X 50
-#define MAZE_ORIGIN_Y 50
-#define MAZE_SCALE 2
-#define PIXELS_PER_TILE 8
-#define NUM_TILES_HORIZONTAL 28
-#define NUM_TILES_VERTICAL 31
-#define STARTING_ROW 23
-#define STARTING_COLUMN 13
+#define PROFILE_CSV_PATH "profile.csv"
+#define VIEW_MARGIN 4
+#define TICKS_PER_INPUT 30
+#define AGENT_BUDGET_SECONDS 0.008                 // leaves half the frame for everything else
+#define SIM_TICK_RATE 60                           // simulation ticks per second at 1x
+#define SIM_DELTA_TIME (1.0f / SIM_TICK_RATE)
+#define SIM_FRAME_BUDGET 0.012                     // seconds of stepping a frame may spend before drawing
 
-typedef enum Orientation { 
-    up,
-    down,
-    left,
-    right,
-    none
-} Orientation;
+// speed multipliers stepped through with - and =; 0 toggles running as fast as the budget allows //
+static const int SPEEDS[] = { 1, 2, 5, 10, 20, 50, 100 };
+#define NUM_SPEEDS ((int)(sizeof(SPEEDS) / sizeof(SPEEDS[0])))
 
-typedef enum GhostState {
-    chase,
-    scatter,
-    frightened,
-} GhostState;
+// until every ghost has its own sprite they all wear Blinky's, tinted by personality //
+static const Color GHOST_TINTS[NUM_PERSONALITIES] = { WHITE, PINK, SKYBLUE, ORANGE, PURPLE, LIME };
 
-typedef struct Actor {
-    Vector2 centroid;
-    int width;
-    int height;
-    int currentTileX;
-    int currentTileY;
-    Orientation orientation;
-    float speed;
-} Actor;
+// Where one game's maze sits on screen; scale 1 is the layout of a single game //
+typedef struct GameView {
+    Vector2 origin;
+    float scale;
+} GameView;
 
-typedef struct Ghost : Actor {
-    int nextTileX;
-    int nextTileY;
-    int nextNextTileX;
-    int nextNextTileY;
-    Vector2 pendingPosition;
-    Orientation pendingDirection;
-    int targetTileX;
-    int targetTileY;    
-} Ghost;
-
-typedef struct Coordinate {
-    int x;
-    int y;
-} Coordinate;
-
-// Custom logging funtion
-void LogCustom(int msgType, const char *text, va_list args)
-{
-    char timeStr[64] = { 0 };
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
-
-    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", tm_info);
-    printf("[%s] ", timeStr);
-
-    switch (msgType)
-    {
-        case LOG_INFO: printf("[INFO] : "); break;
-        case LOG_ERROR: printf("[ERROR]: "); break;
-        case LOG_WARNING: printf("[WARN] : "); break;
-        case LOG_DEBUG: printf("[DEBUG]: "); break;
-        default: break;
+// Tiles count games across the screen in a near-square grid //
+static std::vector<GameView> LayoutViews(int count, int layerWidth, int layerHeight) {
+    std::vector<GameView> views(count);
+    if (count == 1) {
+        views[0] = GameView{Vector2{MAZE_ORIGIN_X, MAZE_ORIGIN_Y}, 1};
+        return views;
     }
 
-    vprintf(text, args);
-    printf("\n");
+    int columns = 1;
+    while (columns * columns < count)
+        columns++;
+    int rows = (count + columns - 1) / columns;
+    float cellWidth = (float)SCREEN_WIDTH / columns;
+    float cellHeight = (float)SCREEN_HEIGHT / rows;
+    float scaleX = (cellWidth - VIEW_MARGIN) / layerWidth;
+    float scaleY = (cellHeight - VIEW_MARGIN) / layerHeight;
+    float scale = scaleX < scaleY ? scaleX : scaleY;
+    for (int i = 0; i < count; i++)
+        views[i] = GameView{Vector2{cellWidth * (i % columns) + VIEW_MARGIN / 2, cellHeight * (i / columns) + VIEW_MARGIN / 2}, scale};
+    return views;
 }
 
-Vector2 CalculatePositionBasedOnTile(int row, int column, float cellSize){
-    return Vector2{MAZE_ORIGIN_X + (column * cellSize) + (cellSize / 2), MAZE_ORIGIN_Y + (row * cellSize) + (cellSize / 2)};
+static Vector2 ToView(const GameView &view, Vector2 position) {
+    return Vector2{view.origin.x + (position.x - MAZE_ORIGIN_X) * view.scale, view.origin.y + (position.y - MAZE_ORIGIN_Y) * view.scale};
 }
 
-void SetCurrentTileForActor(Actor &actor, float cellSize) {
-    actor.currentTileX = floor((actor.centroid.x - MAZE_ORIGIN_X) / cellSize);
-    actor.currentTileY = floor((actor.centroid.y - MAZE_ORIGIN_Y) / cellSize);    
+static Vector2 Interpolate(Vector2 from, Vector2 to, float alpha) {
+    return Vector2{from.x + (to.x - from.x) * alpha, from.y + (to.y - from.y) * alpha};
 }
 
-bool IsTraversable(const Actor &actor, Orientation direction, float deltaTime, float cellSize, const int (&grid)[NUM_TILES_VERTICAL][NUM_TILES_HORIZONTAL]) {
-    
-    float theoreticalPositionX;
-    float theoreticalPositionY;
-    int targetTileX;
-    int targetTileY; 
-    
-    if (direction == left) {
-        theoreticalPositionX = actor.centroid.x - actor.speed * deltaTime;
-        theoreticalPositionY = actor.centroid.y;
-        targetTileX = floor((theoreticalPositionX - MAZE_ORIGIN_X) / cellSize);
-        targetTileY = actor.currentTileY;
-        
-        // verify target tile is within grid bounds //
-        if (targetTileX > -1 && targetTileX < NUM_TILES_HORIZONTAL) {
-            
-            // actor can only move to a tile which is not an obstacle //
-            if (grid[targetTileY][targetTileX] == 1) {
-                
-                if (actor.orientation == left || actor.orientation == right || actor.orientation == none) {
-                    
-                    // if actor is approaching a barrier, we don't want it to proceed past the centroid of its target tile //
-                    if (!(grid[targetTileY][targetTileX - 1] == 0 && actor.centroid.x <= MAZE_ORIGIN_X + targetTileX * cellSize + (cellSize / 2))) {
-                        return true;
-                    }                    
-                }
-                
-                // if moving vertically, only allow horizontal turn if actor is level with target tile's centroid //
-                else if (theoreticalPositionY - (MAZE_ORIGIN_Y + targetTileY * cellSize + (cellSize / 2)) < 1) {
-                    
-                    
-                    if (targetTileX - 1 > 0 && grid[targetTileY][targetTileX - 1] == 1) {     
-                        return true;
-                    }
-                }
-            }
-        }
-    }
-    else if (direction == right) {
-        theoreticalPositionX = actor.centroid.x + actor.speed * deltaTime;
-        theoreticalPositionY = actor.centroid.y;
-        targetTileX = floor((theoreticalPositionX - MAZE_ORIGIN_X) / cellSize);
-        targetTileY = actor.currentTileY;
-        
-        // verify target tile is within grid bounds //
-        if (targetTileX > -1 && targetTileX < NUM_TILES_HORIZONTAL) {
-            
-            // actor can only move to a tile which is not an obstacle //
-            if (grid[targetTileY][targetTileX] == 1) {
-                
-                if (actor.orientation == left || actor.orientation == right || actor.orientation == none) {
-                    
-                    // if actor is approaching a barrier, we don't want it to proceed past the centroid of its target tile //
-                    if (!(grid[targetTileY][targetTileX + 1] == 0 && actor.centroid.x >= MAZE_ORIGIN_X + targetTileX * cellSize + (cellSize / 2))) {
-                        return true;
-                    }                    
-                }
-                
-                // if moving vertically, only allow horizontal turn if actor is level with target tile's centroid //
-                else if (theoreticalPositionY - (MAZE_ORIGIN_Y + targetTileY * cellSize + (cellSize / 2)) < 1) {                   
-                    
-                    if (targetTileX + 1 < NUM_TILES_HORIZONTAL && grid[targetTileY][targetTileX + 1] == 1) {     
-                        return true;
-                    }
-                }
-            }
-        }
-    }
-    else if (direction == up) {
-        theoreticalPositionX = actor.centroid.x;
-        theoreticalPositionY = actor.centroid.y - actor.speed * deltaTime;
-        targetTileX = actor.currentTileX;
-        targetTileY = floor((theoreticalPositionY - MAZE_ORIGIN_Y) / cellSize);
-                
-        // verify target tile is within grid bounds //
-        if (targetTileY > -1 && targetTileY < NUM_TILES_VERTICAL) {
-            
-            // actor can only move to a tile which is not an obstacle //
-            if (grid[targetTileY][targetTileX] == 1) {
-                
-                if (actor.orientation == up || actor.orientation == down || actor.orientation == none) {
-                    
-                    // if actor is approaching a barrier, we don't want it to proceed past the centroid of its target tile //
-                    if (!(grid[targetTileY - 1][targetTileX] == 0 && actor.centroid.y <= MAZE_ORIGIN_Y + targetTileY * cellSize + (cellSize / 2))) {
-                        return true;
-                    }                            
-                }
-                
-                // if moving horizontally, only allow vertical turn if actor is level with target tile's centroid //
-                else if (theoreticalPositionX - (MAZE_ORIGIN_X + targetTileX * cellSize + (cellSize / 2)) < 1) {
-                            
-                        if (targetTileY - 1 > 0 && grid[targetTileY - 1][targetTileX] == 1) { 
-                            return true;
-                        }
-                }
-            }
-        }
+// cheap LCG driving the games nobody is playing //
+static Orientation NextInput(unsigned int &rng) {
+    rng = rng * 1664525u + 1013904223u;
+    return (Orientation)((rng >> 16) % 4);
+}
+
+// The maze picture (or for a maze file, which has none, its walls as blocks) plus, optionally,
+// an outline on every walkable tile. Drawn once into layer whenever either changes, so a frame
+// only pays for a single blit //
+static void RenderMazeLayer(RenderTexture2D &layer, const Texture2D *picture, const Grid &grid, bool showGrid) {
+    BeginTextureMode(layer);
+    ClearBackground(BLANK);
+    if (picture != NULL)
+        DrawTextureEx(*picture, Vector2{0, 0}, 0, MAZE_SCALE, WHITE);
+    else {
+        for (int i = 0; i < NUM_TILES_VERTICAL; i++)
+            for (int j = 0; j < NUM_TILES_HORIZONTAL; j++)
+                if (grid[i][j] != 1)
+                    DrawRectangle(CELL_SIZE * j, CELL_SIZE * i, CELL_SIZE, CELL_SIZE, DARKBLUE);
     }
-    else if (direction == down) {
-        theoreticalPositionX = actor.centroid.x;
-        theoreticalPositionY = actor.centroid.y + actor.speed * deltaTime;
-        targetTileX = actor.currentTileX;
-        targetTileY = floor((theoreticalPositionY - MAZE_ORIGIN_Y) / cellSize);
-                
-        // verify target tile is within grid bounds //
-        if (targetTileY > -1 && targetTileY < NUM_TILES_VERTICAL) {
-            
-            // actor can only move to a tile which is not an obstacle //
-            if (grid[targetTileY][targetTileX] == 1) {
-                
-                if (actor.orientation == up || actor.orientation == down || actor.orientation == none) {
-                    
-                    // if actor is approaching a barrier, we don't want it to proceed past the centroid of its target tile //
-                    if (!(grid[targetTileY + 1][targetTileX] == 0 && actor.centroid.y >= MAZE_ORIGIN_Y + targetTileY * cellSize + (cellSize / 2))) {
-                        return true;
-                    }                            
-                }
-                
-                // if moving horizontally, only allow vertical turn if actor is level with target tile's centroid //
-                else if (theoreticalPositionX - (MAZE_ORIGIN_X + targetTileX * cellSize + (cellSize / 2)) < 1) {
-                            
-                        if (targetTileY + 1 < NUM_TILES_VERTICAL && grid[targetTileY + 1][targetTileX] == 1) { 
-                            return true;
-                        }
-                }
+    if (showGrid) {
+        for (int i = 0; i < NUM_TILES_VERTICAL; i++) {
+            for (int j = 0; j < NUM_TILES_HORIZONTAL; j++) {
+                if (grid[i][j] == 1)
+                    DrawRectangleLines(CELL_SIZE * j, CELL_SIZE * i, CELL_SIZE, CELL_SIZE, GREEN);
             }
         }
     }
-  
-    return false; 
+    EndTextureMode();
+}
+
+// A fresh game, with the player sized to its sprite rather than its tile //
+static void StartGame(Simulation &game, const SpriteAtlas &atlas) {
+    game.Reset();
+    game.player.width = atlas.Size(SPRITE_PACMAN, MAZE_SCALE).x;
+    game.player.height = atlas.Size(SPRITE_PACMAN, MAZE_SCALE).y;
 }
 
-void MoveActor(Actor &actor, Orientation orientation, float deltaTime, float cellSize) {
-    if (orientation == left)
-        actor.centroid.x = actor.centroid.x - actor.speed * deltaTime;
-    else if (orientation == right)
-        actor.centroid.x = actor.centroid.x + actor.speed * deltaTime;
-    else if (orientation == up)
-        actor.centroid.y = actor.centroid.y - actor.speed * deltaTime;
-    else if (orientation == down)
-        actor.centroid.y = actor.centroid.y + actor.speed * deltaTime;
-    actor.orientation = orientation;
-    SetCurrentTileForActor(actor, cellSize);
+// Where a game's actors are now, for drawing them partway to where the next tick puts them //
+static void RememberPositions(const Simulation &game, Vector2 &player, Vector2 *ghosts) {
+    player = game.player.centroid;
+    for (int g = 0; g < game.ghosts.count; g++)
+        ghosts[g] = Vector2{game.ghosts.centroidX[g], game.ghosts.centroidY[g]};
 }
 
-bool IsReversal(Orientation actorDirection, Orientation newDirection) {
-    if (actorDirection == left && newDirection == right)
-        return true;
-    else if (actorDirection == right && newDirection == left)
-        return true;
-    else if (actorDirection == up && newDirection == down)
-        return true;
-    else if (actorDirection == down && newDirection == up)
-        return true;    
-    return false;
+// p50/p99 of every phase's time per frame in the top-left corner, in microseconds //
+static void DrawProfilerOverlay(const Profiler &profiler) {
+    DrawRectangle(0, 0, 300, 20 + 20 * PHASE_COUNT, Fade(BLACK, 0.7f));
+    DrawText("phase      p50 us   p99 us", 10, 5, 10, RAYWHITE);
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const Histogram &h = profiler.phases[i];
+        DrawText(TextFormat("%-8s %8.1f %8.1f", PHASE_NAMES[i], h.Percentile(50) / 1000.0f, h.Percentile(99) / 1000.0f), 10, 20 + 20 * i, 10, RAYWHITE);
+    }
 }
 
-int main(void)
+int main(int argc, char **argv)
 {
+    // -games n tiles n games on screen; the keyboard drives the first, the rest wander.
+    // -maze file plays them all on a maze file instead of the stock maze //
+    int numGames = 1;
+    const char *mazePath = NULL;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "-games") == 0)
+            numGames = atoi(argv[i + 1]) > 1 ? atoi(argv[i + 1]) : 1;
+        if (strcmp(argv[i], "-maze") == 0)
+            mazePath = argv[i + 1];
+    }
+
     // Initialization
     //--------------------------------------------------------------------------------------
+    LogStart(stdout, LOG_FORMAT_TEXT);
+    SetTraceLogCallback(LogCustom);
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "PacAI");
     SetTargetFPS(60);                    
     
     Texture2D maze = LoadTexture("resources/maze.png");
-    Texture2D pacman = LoadTexture("resources/pacman.png");
-    Texture2D blinky_png = LoadTexture("resources/blinky.png");    
+    SpriteAtlas atlas;
+    atlas.Load();
     
     // Initialize Grid //
-    const Vector2 mazeOrigin = Vector2{MAZE_ORIGIN_X, MAZE_ORIGIN_Y};
     float cellWidth = PIXELS_PER_TILE * MAZE_SCALE;
     float cellHeight = PIXELS_PER_TILE * MAZE_SCALE;
-    float cellSize = PIXELS_PER_TILE * MAZE_SCALE;
     
-    int grid[NUM_TILES_VERTICAL][NUM_TILES_HORIZONTAL] = {
-        {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},  
-        {0,1,1,1,1,1,1,1,1,1,1,1,1,0,0,1,1,1,1,1,1,1,1,1,1,1,1,0},
-        {0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0},
-        {0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0},
-        {0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0},
-        {0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0},
-        {0,1,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,1,0},
-        {0,1,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,1,0},
-        {0,1,1,1,1,1,1,0,0,1,1,1,1,0,0,1,1,1,1,0,0,1,1,1,1,1,1,0},
-        {0,0,0,0,0,0,1,0,0,0,0,0,1,0,0,1,0,0,0,0,0,1,0,0,0,0,0,0},
-        {0,0,0,0,0,0,1,0,0,0,0,0,1,0,0,1,0,0,0,0,0,1,0,0,0,0,0,0},
-        {0,0,0,0,0,0,1,0,0,1,1,1,1,1,1,1,1,1,1,0,0,1,0,0,0,0,0,0},
-        {0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0},
-        {0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0},
-        {1,1,1,1,1,1,1,1,1,1,0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,1,1},
-        {0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0},
-        {0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0},
-        {0,0,0,0,0,0,1,0,0,1,1,1,1,1,1,1,1,1,1,0,0,1,0,0,0,0,0,0},
-        {0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0},
-        {0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0},
-        {0,1,1,1,1,1,1,1,1,1,1,1,1,0,0,1,1,1,1,1,1,1,1,1,1,1,1,0},
-        {0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0},
-        {0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0},
-        {0,1,1,1,0,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,0,1,1,1,0},
-        {0,0,0,1,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,1,0,0,0},
-        {0,0,0,1,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,1,0,0,0},
-        {0,1,1,1,1,1,1,0,0,1,1,1,1,0,0,1,1,1,1,0,0,1,1,1,1,1,1,0},
-        {0,1,0,0,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,0,0,1,0},
-        {0,1,0,0,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,0,0,1,0},
-        {0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0},
-        {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0}
-    }; 
-    
-    // Initialize Player //
-    Actor player;    
-    player.centroid = CalculatePositionBasedOnTile(STARTING_ROW, STARTING_COLUMN, cellSize);
-    player.width = pacman.width * MAZE_SCALE;
-    player.height = pacman.height * MAZE_SCALE;
-    player.currentTileX = STARTING_COLUMN;
-    player.currentTileY = STARTING_ROW;
-    player.orientation = left;
-    player.speed = 100;
+    // Initialize Simulation //
+    // the search agent models the stock maze only, so it sits out games on a maze file //
+    MazeCache mazes;
+    std::shared_ptr<const Maze> mazeFile = mazePath != NULL ? mazes.Load(mazePath) : NULL;
+    std::vector<Simulation> games(numGames);
+    for (Simulation &game : games) {
+        if (mazeFile != NULL)
+            game.UseMaze(*mazeFile);
+        StartGame(game, atlas);
+    }
+    Simulation &sim = games[0];
+    const Grid &grid = *sim.grid;
+    const Actor &player = sim.player;
+    std::vector<Orientation> inputs(numGames, left);
+    unsigned int rng = 12345;
 
-    // Initialize Ghosts //
-    Ghost blinky;
-    blinky.centroid = CalculatePositionBasedOnTile(11, 13, cellSize);
-    blinky.width = blinky_png.width * MAZE_SCALE;
-    blinky.height = blinky_png.height * MAZE_SCALE;
-    blinky.currentTileX = 13;
-    blinky.currentTileY = 11;
-    blinky.nextTileX = 12;
-    blinky.nextTileY = 11;
-    blinky.pendingPosition = CalculatePositionBasedOnTile(blinky.nextTileY, blinky.nextTileX, cellSize);
-    blinky.orientation = left;
-    blinky.pendingDirection = none;
-    blinky.speed = 100;
-    
-    // Initialize AI //
-    GhostState ghostState = chase;
-    Orientation directions[4] { up, left, down, right };
-    
+    // Initialize Timestep //
+    // the simulation ticks at SIM_TICK_RATE whatever the display does; frames draw actors
+    // partway between the last two ticks, so previous* holds each game's positions one tick back //
+    int speedIndex = 0;
+    bool unlimited = false;
+    double accumulator = 0;
+    int ticksThisFrame = 0;
+    std::vector<Vector2> previousPlayer(numGames);
+    std::vector<Vector2> previousGhosts(numGames * ROSTER_CAPACITY);
+    for (int i = 0; i < numGames; i++)
+        RememberPositions(games[i], previousPlayer[i], &previousGhosts[i * ROSTER_CAPACITY]);
+
+    // Initialize Maze Layer //
+    int layerWidth = maze.width * MAZE_SCALE > NUM_TILES_HORIZONTAL * CELL_SIZE ? maze.width * MAZE_SCALE : NUM_TILES_HORIZONTAL * CELL_SIZE;
+    int layerHeight = maze.height * MAZE_SCALE > NUM_TILES_VERTICAL * CELL_SIZE ? maze.height * MAZE_SCALE : NUM_TILES_VERTICAL * CELL_SIZE;
+    RenderTexture2D mazeLayer = LoadRenderTexture(layerWidth, layerHeight);
+    bool showGrid = true;
+    const Texture2D *picture = mazeFile == NULL ? &maze : NULL;
+    RenderMazeLayer(mazeLayer, picture, grid, showGrid);
+    std::vector<GameView> views = LayoutViews(numGames, layerWidth, layerHeight);
+
+    // Initialize Profiler //
+    // every game's ticks add into the same player and AI samples, one per frame like input and
+    // render, however many games or ticks the frame runs //
+    static Profiler profiler;
+    profiler.Clear();
+    for (Simulation &game : games)
+        game.profiler = &profiler;
+    bool showProfiler = false;
+
+    // Initialize Agent //
+    ThreadPool pool;
+    MctsAgent agent(pool, AGENT_BUDGET_SECONDS);
+    bool agentPlays = false;
   
     // Main game loop
     while (!WindowShouldClose())
     {
-        float deltaTime = GetFrameTime();      
+        float frameTime = GetFrameTime();
 
         // Process Input
         //----------------------------------------------------------------------------------
-        Orientation inp;
+        uint64_t phaseStart = ProfilerNow();
+        Orientation inp = none;
         if (IsKeyDown(KEY_LEFT))
             inp = left;
         else if (IsKeyDown(KEY_RIGHT))
@@ -353,137 +224,107 @@ int main(void)
             inp = up;
         else if (IsKeyDown(KEY_DOWN))
             inp = down;
+        if (IsKeyPressed(KEY_F1))
+            showProfiler = !showProfiler;
+        if (IsKeyPressed(KEY_A) && mazeFile == NULL)
+            agentPlays = !agentPlays;
+        if (agentPlays)
+            inp = agent.Decide(agent.Observe(sim));
+        if (IsKeyPressed(KEY_G)) {
+            showGrid = !showGrid;
+            RenderMazeLayer(mazeLayer, picture, grid, showGrid);
+        }
+        if (IsKeyPressed(KEY_EQUAL) && speedIndex < NUM_SPEEDS - 1)
+            speedIndex++;
+        if (IsKeyPressed(KEY_MINUS) && speedIndex > 0)
+            speedIndex--;
+        if (IsKeyPressed(KEY_ZERO))
+            unlimited = !unlimited;
+        inputs[0] = inp;
+        profiler.End(PHASE_INPUT, phaseStart);
         
-        // Update Player Location
-        //----------------------------------------------------------------------------------
-        
-        if (IsTraversable(player, inp, deltaTime, cellSize, grid))
-            MoveActor(player, inp, deltaTime, cellSize);
-        else if (IsTraversable(player, player.orientation, deltaTime, cellSize, grid))
-            MoveActor(player, player.orientation, deltaTime, cellSize);
-        else
-            player.orientation = none;
-     
-        // Artificial Intelligence
+        // Update Player Location / Artificial Intelligence
         //----------------------------------------------------------------------------------
-        blinky.targetTileX = 26; //player.currentTileX;
-        blinky.targetTileY = 0; //player.currentTileY;
-        Vector2 targetPosition = CalculatePositionBasedOnTile(blinky.targetTileY, blinky.targetTileX, cellSize);
-        
-        if (blinky.pendingDirection == none) {            
-            
-            float minDistance = std::numeric_limits<float>::max();           
-            for (int i = 0; i < 4; i++) {
-                if (IsReversal(blinky.orientation, directions[i])) {
-                    continue;
-                }
-                
-                if (directions[i] == left) {
-                    if (grid[blinky.nextTileY][blinky.nextTileX - 1] == 1) {                        
-                        float dist = Vector2Distance(CalculatePositionBasedOnTile(blinky.nextTileY, blinky.nextTileX - 1, cellSize), targetPosition);
-                        //float dist = abs(blinky.nextTileY - blinky.targetTileY) + abs(blinky.nextTileX - 1 - blinky.targetTileX);
-                        if (dist < minDistance) {
-                            minDistance = dist;
-                            blinky.pendingDirection = left;
-                            blinky.nextNextTileX = blinky.nextTileX - 1;
-                            blinky.nextNextTileY = blinky.nextTileY;
-                            LogCustom(LOG_DEBUG, "left", NULL);
-                        }
-                    }
-                }
-                else if (directions[i] == right) {
-                    if (grid[blinky.nextTileY][blinky.nextTileX + 1] == 1) {
-                        float dist = Vector2Distance(CalculatePositionBasedOnTile(blinky.nextTileY, blinky.nextTileX + 1, cellSize), targetPosition);
-                        //float dist = abs(blinky.nextTileY - blinky.targetTileY) + abs(blinky.nextTileX + 1 - blinky.targetTileX);
-                        if (dist < minDistance) {
-                            minDistance = dist;
-                            blinky.pendingDirection = right;
-                            blinky.nextNextTileX = blinky.nextTileX + 1;
-                            blinky.nextNextTileY = blinky.nextTileY;
-                            LogCustom(LOG_DEBUG, "right", NULL);
-                        }
-                    }
-                }
-                else if (directions[i] == up) {
-                    if (grid[blinky.nextTileY - 1][blinky.nextTileX] == 1) {
-                        float dist = Vector2Distance(CalculatePositionBasedOnTile(blinky.nextTileY - 1, blinky.nextTileX, cellSize), targetPosition);
-                        //float dist = abs(blinky.nextTileY - 1 - blinky.targetTileY) + abs(blinky.nextTileX - blinky.targetTileX);
-                        if (dist < minDistance) {
-                            minDistance = dist;
-                            blinky.pendingDirection = up;
-                            blinky.nextNextTileX = blinky.nextTileX;
-                            blinky.nextNextTileY = blinky.nextTileY - 1;
-                            LogCustom(LOG_DEBUG, "up", NULL);
-                        }
-                    }
+        // Fixed ticks until the accumulated time is used up, or until the frame's budget is;
+        // unlimited just keeps going until the budget runs out. Whatever is left over after
+        // a budget cut is dropped rather than carried, so a slow machine runs slow instead of
+        // falling further behind every frame //
+        if (!unlimited)
+            accumulator += frameTime * SPEEDS[speedIndex];
+        double budgetEnd = GetTime() + SIM_FRAME_BUDGET;
+        ticksThisFrame = 0;
+        while ((unlimited || accumulator >= SIM_DELTA_TIME) && GetTime() < budgetEnd) {
+            for (int i = 0; i < numGames; i++) {
+                RememberPositions(games[i], previousPlayer[i], &previousGhosts[i * ROSTER_CAPACITY]);
+                games[i].Step(inputs[i], SIM_DELTA_TIME);
+                if (i == 0)
+                    agent.Track(sim);
+                if (i > 0 && games[i].tick % TICKS_PER_INPUT == 0)
+                    inputs[i] = NextInput(rng);
+
+                // a caught game starts over straight away, without sliding everyone home //
+                if (games[i].caughtBy != NO_COLLISION) {
+                    if (i == 0)
+                        agent.Restart();
+                    StartGame(games[i], atlas);
+                    RememberPositions(games[i], previousPlayer[i], &previousGhosts[i * ROSTER_CAPACITY]);
                 }
-                else if (directions[i] == down) {
-                    if (grid[blinky.nextTileY + 1][blinky.nextTileX] == 1) {
-                        float dist = Vector2Distance(CalculatePositionBasedOnTile(blinky.nextTileY + 1, blinky.nextTileX, cellSize), targetPosition);
-                        //float dist = abs(blinky.nextTileY + 1 - blinky.targetTileY) + abs(blinky.nextTileX - blinky.targetTileX);
-                        if (dist < minDistance) {
-                            minDistance = dist;
-                            blinky.pendingDirection = down;
-                            blinky.nextNextTileX = blinky.nextTileX;
-                            blinky.nextNextTileY = blinky.nextTileY + 1;
-                            LogCustom(LOG_DEBUG, "down", NULL);
-                        }
-                    }
-                }                              
-            }
-                        
-        }
-        
-        if (abs(blinky.pendingPosition.x - blinky.centroid.x) < 1 && abs(blinky.pendingPosition.y - blinky.centroid.y) < 1) {
-        //if (Vector2Distance(blinky.pendingPosition, blinky.centroid) < 1) {
-            if (IsTraversable(blinky, blinky.pendingDirection, deltaTime, cellSize, grid)) {                
-                MoveActor(blinky, blinky.pendingDirection, deltaTime, cellSize);
-                blinky.pendingDirection = none;
-                blinky.nextTileX = blinky.nextNextTileX;
-                blinky.nextTileY = blinky.nextNextTileY;
-                blinky.pendingPosition = CalculatePositionBasedOnTile(blinky.nextTileY, blinky.nextTileX, cellSize);
             }
-            else
-                if (IsTraversable(blinky, blinky.orientation, deltaTime, cellSize, grid))
-                    MoveActor(blinky, blinky.orientation, deltaTime, cellSize);
-                //LogCustom(LOG_DEBUG, "trying to move, but can't!", NULL);            
+            accumulator -= SIM_DELTA_TIME;
+            ticksThisFrame++;
         }
-        else
-            if (IsTraversable(blinky, blinky.orientation, deltaTime, cellSize, grid))
-                MoveActor(blinky, blinky.orientation, deltaTime, cellSize);
+        if (unlimited || accumulator >= SIM_DELTA_TIME)
+            accumulator = 0;
+        profiler.Flush(PHASE_PLAYER);
+        profiler.Flush(PHASE_AI);
+        float alpha = unlimited ? 1 : (float)(accumulator / SIM_DELTA_TIME);
 
         // Render
         //----------------------------------------------------------------------------------
+        phaseStart = ProfilerNow();
         BeginDrawing();
         
         ClearBackground(BLACK);
         
-        DrawTextureEx(maze, mazeOrigin, 0, MAZE_SCALE, WHITE);
-        
-        for (int i = 0; i < NUM_TILES_VERTICAL; i++) {
-            for (int j = 0; j < NUM_TILES_HORIZONTAL; j++) {
-                float x = mazeOrigin.x + (cellWidth * j);
-                float y = mazeOrigin.y + (cellHeight * i);
-                
-                if (grid[i][j] == 1)
-                    DrawRectangleLines(x, y, cellWidth, cellHeight, GREEN);
-                // else
-                    // DrawRectangleLines(x, y, cellWidth, cellHeight, RED);                    
-                
+        // render textures are stored upside down, hence the negative source height //
+        Rectangle layerSource = Rectangle{0, 0, (float)layerWidth, -(float)layerHeight};
+        for (const GameView &view : views)
+            DrawTexturePro(mazeLayer.texture, layerSource, Rectangle{view.origin.x, view.origin.y, layerWidth * view.scale, layerHeight * view.scale}, Vector2{0, 0}, 0, WHITE);
+
+        // every actor of every game in one pass over the atlas, so they batch into one draw call //
+        for (int i = 0; i < numGames; i++) {
+            const GameView &view = views[i];
+            atlas.Draw(SPRITE_PACMAN, ToView(view, Interpolate(previousPlayer[i], games[i].player.centroid, alpha)), MAZE_SCALE * view.scale, WHITE);
+            const GhostRoster &ghosts = games[i].ghosts;
+            for (int g = 0; g < ghosts.count; g++) {
+                Vector2 current = Vector2{ghosts.centroidX[g], ghosts.centroidY[g]};
+                atlas.Draw(SPRITE_BLINKY, ToView(view, Interpolate(previousGhosts[i * ROSTER_CAPACITY + g], current, alpha)), MAZE_SCALE * view.scale, GHOST_TINTS[ghosts.personality[g]]);
             }
         }
-                
-        DrawRectangleLines(mazeOrigin.x + (cellWidth * player.currentTileX), mazeOrigin.y + (cellHeight * player.currentTileY), cellWidth, cellHeight, RED);
-        DrawTextureEx(pacman, Vector2{player.centroid.x - player.width / 2, player.centroid.y - player.height / 2}, 0, MAZE_SCALE, WHITE);       
-        DrawTextureEx(blinky_png, Vector2{blinky.centroid.x - blinky.width / 2, blinky.centroid.y - blinky.height / 2}, 0, MAZE_SCALE, WHITE);       
+
+        Vector2 playerTile = ToView(views[0], Vector2{MAZE_ORIGIN_X + (cellWidth * player.currentTileX), MAZE_ORIGIN_Y + (cellHeight * player.currentTileY)});
+        DrawRectangleLines(playerTile.x, playerTile.y, cellWidth * views[0].scale, cellHeight * views[0].scale, RED);
+
+        if (unlimited || speedIndex > 0)
+            DrawText(unlimited ? TextFormat("max  %d ticks/frame", ticksThisFrame) : TextFormat("%dx  %d ticks/frame", SPEEDS[speedIndex], ticksThisFrame), 10, SCREEN_HEIGHT - 30, 20, RAYWHITE);
+        if (showProfiler)
+            DrawProfilerOverlay(profiler);
+        profiler.End(PHASE_RENDER, phaseStart);
     
+        // also waits out the rest of the frame for SetTargetFPS, so it stays out of the render phase //
         EndDrawing();
         
     }
 
     // De-Initialization
     //--------------------------------------------------------------------------------------
+    UnloadRenderTexture(mazeLayer);
+    atlas.Unload();
+    UnloadTexture(maze);
     CloseWindow();        // Close window and OpenGL context
+    if (profiler.WriteCsv(PROFILE_CSV_PATH))
+        LogMessage(LOG_LEVEL_INFO, "PROFILER: Phase timings written to %s", PROFILE_CSV_PATH);
+    LogStop();
     //--------------------------------------------------------------------------------------
 
     return 0;
@@ -0,0 +1,394 @@
+/*******************************************************************************************
+*
+*   PacAI microbenchmarks
+*
+*   Times the movement and AI kernels one call at a time over random legal positions and
+*   headings, then whole steps with growing numbers of ghosts and environments.
+*
+*   Build: g++ -std=c++17 -O2 -DNDEBUG -pthread PacAIBench.cpp Simulation.cpp
+*          MazeTables.cpp Bitboard.cpp CollisionIndex.cpp BatchSimulation.cpp ThreadPool.cpp
+*          Log.cpp Profiler.cpp -o PacAIBench
+*   Usage: PacAIBench [-filter text] [-min-time seconds] [-seed n] [-threads n]
+*                     [-save file] [-baseline file] [-tolerance fraction]
+*
+*   -save writes "name ns/op" lines for every case run. -baseline reads such a file back and
+*   exits with status 1 if any case is more than -tolerance (default 0.15) slower than it.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "Simulation.h"
+#include "MazeTables.h"
+#include "Bitboard.h"
+#include "BatchSimulation.h"
+#include "CollisionIndex.h"
+#include "Log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define DEFAULT_MIN_TIME 0.05
+#define DEFAULT_TOLERANCE 0.15
+#define DEFAULT_SEED 12345
+#define BENCH_REPEATS 5
+#define SAMPLE_COUNT 4096                   // power of two, so ops index samples with a mask
+#define BENCH_DELTA_TIME (1.0f / 60.0f)
+
+typedef struct BenchOptions {
+    const char *filter = NULL;
+    double minTime = DEFAULT_MIN_TIME;
+    unsigned int seed = DEFAULT_SEED;
+    int threads = 0;
+    const char *savePath = NULL;
+    const char *baselinePath = NULL;
+    double tolerance = DEFAULT_TOLERANCE;
+} BenchOptions;
+
+static BenchOptions ParseOptions(int argc, char **argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : "0";
+        if (strcmp(argv[i], "-filter") == 0) { options.filter = value; i++; }
+        else if (strcmp(argv[i], "-min-time") == 0) { options.minTime = atof(value); i++; }
+        else if (strcmp(argv[i], "-seed") == 0) { options.seed = (unsigned int)strtoul(value, NULL, 10); i++; }
+        else if (strcmp(argv[i], "-threads") == 0) { options.threads = atoi(value); i++; }
+        else if (strcmp(argv[i], "-save") == 0) { options.savePath = value; i++; }
+        else if (strcmp(argv[i], "-baseline") == 0) { options.baselinePath = value; i++; }
+        else if (strcmp(argv[i], "-tolerance") == 0) { options.tolerance = atof(value); i++; }
+        else printf("ignoring unknown option %s\n", argv[i]);
+    }
+    return options;
+}
+
+static unsigned int NextRandom(unsigned int &rng) {
+    rng = rng * 1664525u + 1013904223u;
+    return rng >> 8;
+}
+
+// Results are folded in here so the compiler can't drop the calls being timed //
+static volatile float benchSink;
+
+// A position on a walkable tile, heading out through one of its exits and up to half a
+// tile past the centre in that direction, so every sample is somewhere a real actor can be //
+typedef struct BenchSample {
+    Ghost ghost;
+    Orientation input;
+    int row;
+    int column;
+} BenchSample;
+
+static std::vector<BenchSample> MakeSamples(unsigned int &rng) {
+    std::vector<Coordinate> tiles;
+    for (int i = 0; i < NUM_TILES_VERTICAL; i++)
+        for (int j = 0; j < NUM_TILES_HORIZONTAL; j++)
+            if (DEFAULT_BITBOARD.LegalMoves(i, j) != 0)
+                tiles.push_back(Coordinate{j, i});
+
+    std::vector<BenchSample> samples(SAMPLE_COUNT);
+    for (BenchSample &sample : samples) {
+        Coordinate tile = tiles[NextRandom(rng) % tiles.size()];
+        uint8_t exits = DEFAULT_BITBOARD.LegalMoves(tile.y, tile.x);
+        int pick = NextRandom(rng) % __builtin_popcount(exits);
+        Orientation heading = none;
+        for (int d = up; d <= right && heading == none; d++)
+            if ((exits & (1 << d)) && pick-- == 0)
+                heading = (Orientation)d;
+
+        float offset = (NextRandom(rng) % 1000) / 1000.0f * (CELL_SIZE / 2);
+        Ghost &ghost = sample.ghost;
+        ghost.centroid = CalculatePositionBasedOnTile(tile.y, tile.x, CELL_SIZE);
+        ghost.centroid.x += MazeTablesDetail::STEP_X[heading] * offset;
+        ghost.centroid.y += MazeTablesDetail::STEP_Y[heading] * offset;
+        ghost.width = CELL_SIZE;
+        ghost.height = CELL_SIZE;
+        ghost.currentTileX = tile.x;
+        ghost.currentTileY = tile.y;
+        ghost.orientation = heading;
+        ghost.speed = ACTOR_SPEED;
+        ghost.nextTileX = tile.x + MazeTablesDetail::STEP_X[heading];
+        ghost.nextTileY = tile.y + MazeTablesDetail::STEP_Y[heading];
+        ghost.nextNextTileX = ghost.nextTileX;
+        ghost.nextNextTileY = ghost.nextTileY;
+        ghost.pendingPosition = CalculatePositionBasedOnTile(ghost.nextTileY, ghost.nextTileX, CELL_SIZE);
+        ghost.pendingDirection = none;
+        Coordinate target = tiles[NextRandom(rng) % tiles.size()];
+        ghost.targetTileX = target.x;
+        ghost.targetTileY = target.y;
+
+        sample.input = (Orientation)(NextRandom(rng) % 4);
+        sample.row = NextRandom(rng) % NUM_TILES_VERTICAL;
+        sample.column = NextRandom(rng) % NUM_TILES_HORIZONTAL;
+    }
+    return samples;
+}
+
+// Runs ops operations //
+typedef std::function<void(long long ops)> BenchBody;
+
+typedef struct BenchCase {
+    std::string name;
+    double opsPerCall;                      // ops covered by one body iteration, e.g. games per batch step
+    BenchBody body;
+} BenchCase;
+
+typedef struct BenchResult {
+    std::string name;
+    double nsPerOp;
+} BenchResult;
+
+static double TimeBody(const BenchBody &body, long long iterations) {
+    auto start = std::chrono::steady_clock::now();
+    body(iterations);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// Grows the iteration count until one run lasts minTime, then keeps the best of a few runs //
+static BenchResult RunCase(const BenchCase &bench, double minTime) {
+    long long iterations = 1;
+    double seconds = TimeBody(bench.body, iterations);
+    while (seconds < minTime) {
+        double scale = seconds > 0 ? minTime / seconds * 1.2 : 10;
+        iterations = (long long)(iterations * (scale < 10 ? scale : 10)) + 1;
+        seconds = TimeBody(bench.body, iterations);
+    }
+    for (int i = 1; i < BENCH_REPEATS; i++) {
+        double repeat = TimeBody(bench.body, iterations);
+        seconds = repeat < seconds ? repeat : seconds;
+    }
+    return BenchResult{bench.name, seconds * 1e9 / (iterations * bench.opsPerCall)};
+}
+
+static std::vector<BenchCase> MakeCases(const std::vector<BenchSample> &samples, ThreadPool &pool) {
+    std::vector<BenchCase> cases;
+    const BenchSample *s = samples.data();
+    const int mask = SAMPLE_COUNT - 1;
+
+    cases.push_back({"IsTraversable/grid", 1, [s, mask](long long ops) {
+        int count = 0;
+        for (long long i = 0; i < ops; i++)
+            count += IsTraversable(s[i & mask].ghost, s[i & mask].input, BENCH_DELTA_TIME, CELL_SIZE, DEFAULT_GRID);
+        benchSink = count;
+    }});
+    cases.push_back({"IsTraversable/bitboard", 1, [s, mask](long long ops) {
+        int count = 0;
+        for (long long i = 0; i < ops; i++)
+            count += IsTraversable(s[i & mask].ghost, s[i & mask].input, BENCH_DELTA_TIME, CELL_SIZE, DEFAULT_BITBOARD);
+        benchSink = count;
+    }});
+    cases.push_back({"MoveActor", 1, [s, mask](long long ops) {
+        float total = 0;
+        for (long long i = 0; i < ops; i++) {
+            Actor actor = s[i & mask].ghost;
+            MoveActor(actor, actor.orientation, BENCH_DELTA_TIME, CELL_SIZE);
+            total += actor.centroid.x + actor.centroid.y;
+        }
+        benchSink = total;
+    }});
+    cases.push_back({"SetCurrentTileForActor", 1, [s, mask](long long ops) {
+        int total = 0;
+        for (long long i = 0; i < ops; i++) {
+            Actor actor = s[i & mask].ghost;
+            SetCurrentTileForActor(actor, CELL_SIZE);
+            total += actor.currentTileX + actor.currentTileY;
+        }
+        benchSink = total;
+    }});
+    cases.push_back({"CalculatePositionBasedOnTile", 1, [s, mask](long long ops) {
+        float total = 0;
+        for (long long i = 0; i < ops; i++) {
+            Vector2 position = CalculatePositionBasedOnTile(s[i & mask].row, s[i & mask].column, CELL_SIZE);
+            total += position.x + position.y;
+        }
+        benchSink = total;
+    }});
+    cases.push_back({"ChooseGhostDirection/routes", 1, [s, mask](long long ops) {
+        int total = 0;
+        for (long long i = 0; i < ops; i++) {
+            Ghost ghost = s[i & mask].ghost;
+            ChooseGhostDirection(ghost, DEFAULT_MAZE_ROUTES);
+            total += ghost.pendingDirection;
+        }
+        benchSink = total;
+    }});
+    cases.push_back({"ChooseGhostDirection/grid", 1, [s, mask](long long ops) {
+        int total = 0;
+        for (long long i = 0; i < ops; i++) {
+            Ghost ghost = s[i & mask].ghost;
+            ChooseGhostDirection(ghost, CELL_SIZE, DEFAULT_GRID);
+            total += ghost.pendingDirection;
+        }
+        benchSink = total;
+    }});
+    cases.push_back({"Simulation::Step", 1, [s, mask](long long ops) {
+        Simulation sim;
+        sim.Reset();
+        for (long long i = 0; i < ops; i++)
+            sim.Step(s[i & mask].input, BENCH_DELTA_TIME);
+        benchSink = sim.player.centroid.x + sim.ghosts.centroidX[0];
+    }});
+
+    // Larger rosters of the whole personality table; ns/op is per game step //
+    for (int count : {32, 256}) {
+        cases.push_back({"Simulation::Step/ghosts:" + std::to_string(count), 1, [s, mask, count](long long ops) {
+            std::vector<GhostPersonalityId> roster(count);
+            for (int g = 0; g < count; g++)
+                roster[g] = (GhostPersonalityId)(g % NUM_PERSONALITIES);
+            Simulation sim;
+            sim.Reset(roster.data(), count);
+            for (long long i = 0; i < ops; i++)
+                sim.Step(s[i & mask].input, BENCH_DELTA_TIME);
+            benchSink = sim.player.centroid.x + sim.ghosts.centroidX[0];
+        }});
+    }
+
+    // Ghosts sharing one maze, each routed and moved every tick; ns/op is per ghost //
+    for (int count : {1, 16, 256, 4096}) {
+        cases.push_back({"UpdateGhost/ghosts:" + std::to_string(count), (double)count, [s, count](long long ops) {
+            std::vector<Ghost> ghosts(count);
+            for (int g = 0; g < count; g++)
+                ghosts[g] = s[g].ghost;
+            for (long long i = 0; i < ops; i++) {
+                for (Ghost &ghost : ghosts) {
+                    if (ghost.pendingDirection == none)
+                        ChooseGhostDirection(ghost, DEFAULT_MAZE_ROUTES);
+                    UpdateGhost(ghost, BENCH_DELTA_TIME, CELL_SIZE, DEFAULT_BITBOARD);
+                }
+            }
+            benchSink = ghosts[0].centroid.x;
+        }});
+    }
+
+    // As many players as ghosts, all checked against each other through the tile buckets and
+    // by the all-pairs loop they replace; ns/op is per actor //
+    for (int count : {16, 256}) {
+        std::vector<GhostPersonalityId> roster(count);
+        for (int g = 0; g < count; g++)
+            roster[g] = (GhostPersonalityId)(g % NUM_PERSONALITIES);
+        std::vector<int> cells(count);
+        for (int p = 0; p < count; p++)
+            cells[p] = CollisionCell(s[p].ghost.currentTileY, s[p].ghost.currentTileX);
+
+        cases.push_back({"CollisionIndex/actors:" + std::to_string(count), 2.0 * count, [roster, cells, count](long long ops) {
+            Simulation sim;
+            sim.Reset(roster.data(), count);
+            GhostColumns ghosts = sim.ghosts.Columns();
+            CollisionIndex index;
+            std::vector<int> caughtBy(count);
+            long long total = 0;
+            for (long long i = 0; i < ops; i++) {
+                index.Begin(ghosts);
+                index.Build(ghosts);
+                index.Find(cells.data(), cells.data(), count, caughtBy.data());
+                total += caughtBy[i % count];
+            }
+            benchSink = total;
+        }});
+        cases.push_back({"CollisionAllPairs/actors:" + std::to_string(count), 2.0 * count, [roster, cells, count](long long ops) {
+            Simulation sim;
+            sim.Reset(roster.data(), count);
+            const GhostRoster &ghosts = sim.ghosts;
+            std::vector<int> caughtBy(count);
+            long long total = 0;
+            for (long long i = 0; i < ops; i++) {
+                for (int p = 0; p < count; p++) {
+                    caughtBy[p] = NO_COLLISION;
+                    for (int g = 0; g < ghosts.count && caughtBy[p] == NO_COLLISION; g++)
+                        if (CollisionCell(ghosts.currentTileY[g], ghosts.currentTileX[g]) == cells[p])
+                            caughtBy[p] = g;
+                }
+                total += caughtBy[i % count];
+            }
+            benchSink = total;
+        }});
+    }
+
+    // Whole games stepped in lockstep; ns/op is per game step //
+    for (int count : {1, 64, 1024, 16384}) {
+        cases.push_back({"BatchSimulation::Step/envs:" + std::to_string(count), (double)count, [s, count, &pool](long long ops) {
+            BatchSimulation batch(count, pool);
+            batch.Reset();
+            std::vector<Orientation> inputs(count);
+            for (int env = 0; env < count; env++)
+                inputs[env] = s[env & (SAMPLE_COUNT - 1)].input;
+            for (long long i = 0; i < ops; i++)
+                batch.Step(inputs.data(), BENCH_DELTA_TIME);
+            benchSink = batch.player.centroidX[0];
+        }});
+    }
+    return cases;
+}
+
+static bool SaveBaseline(const char *path, const std::vector<BenchResult> &results) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+        return false;
+    for (const BenchResult &result : results)
+        fprintf(file, "%s %.3f\n", result.name.c_str(), result.nsPerOp);
+    fclose(file);
+    return true;
+}
+
+// Returns the number of cases slower than the baseline by more than tolerance //
+static int CompareBaseline(const char *path, const std::vector<BenchResult> &results, double tolerance) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        printf("could not read baseline %s\n", path);
+        return 1;
+    }
+
+    int regressions = 0;
+    char name[256];
+    double baseline;
+    while (fscanf(file, "%255s %lf", name, &baseline) == 2) {
+        for (const BenchResult &result : results) {
+            if (result.name != name)
+                continue;
+            double change = result.nsPerOp / baseline - 1;
+            bool regressed = change > tolerance;
+            printf("%-40s %10.2f -> %10.2f ns/op  %+6.1f%%%s\n", name, baseline, result.nsPerOp, change * 100, regressed ? "  REGRESSION" : "");
+            regressions += regressed;
+        }
+    }
+    fclose(file);
+    return regressions;
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options = ParseOptions(argc, argv);
+    unsigned int rng = options.seed;
+    LogSetLevel(LOG_LEVEL_INFO);
+
+    std::vector<BenchSample> samples = MakeSamples(rng);
+    ThreadPool pool(options.threads);
+    std::vector<BenchCase> cases = MakeCases(samples, pool);
+
+    std::vector<BenchResult> results;
+    printf("%-40s %12s %16s\n", "case", "ns/op", "ops/sec");
+    for (const BenchCase &bench : cases) {
+        if (options.filter != NULL && strstr(bench.name.c_str(), options.filter) == NULL)
+            continue;
+        BenchResult result = RunCase(bench, options.minTime);
+        printf("%-40s %12.2f %16.0f\n", result.name.c_str(), result.nsPerOp, 1e9 / result.nsPerOp);
+        results.push_back(result);
+    }
+    printf("batch cases ran on %d threads\n", pool.Size());
+
+    if (options.savePath != NULL && !SaveBaseline(options.savePath, results))
+        printf("could not write %s\n", options.savePath);
+
+    if (options.baselinePath != NULL) {
+        int regressions = CompareBaseline(options.baselinePath, results, options.tolerance);
+        if (regressions > 0) {
+            printf("%d case(s) regressed by more than %.0f%%\n", regressions, options.tolerance * 100);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*******************************************************************************************
+*
+*   PacAI observation consumer
+*
+*   Stand-in for the trainer end of the observation ring: attaches to the shared memory,
+*   checks every frame in place for consistency, and answers with a random move into an
+*   open neighbouring tile. Run it next to PacAIHeadless -export name.
+*
+*   Build: g++ -std=c++17 -O2 -pthread PacAIConsumer.cpp ObservationRing.cpp
+*          FixedSimulation.cpp GameState.cpp JunctionGraph.cpp MazeTables.cpp Bitboard.cpp
+*          Simulation.cpp CollisionIndex.cpp Log.cpp Profiler.cpp -lrt -o PacAIConsumer
+*   Usage: PacAIConsumer [-name name] [-frames n]
+*
+*   Exits with status 1 if any frame fails a check.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "ObservationRing.h"
+#include "MazeTables.h"
+#include "Log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#define ATTACH_TIMEOUT_SECONDS 5.0
+#define IDLE_TIMEOUT_SECONDS 2.0
+
+static double Now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Returns a description of the first inconsistency, or NULL //
+static const char *CheckFrame(const ObservationFrame &frame, uint64_t expected) {
+    if (frame.frame != expected)
+        return "frame out of sequence";
+    if (frame.playerTileX < 0 || frame.playerTileX >= NUM_TILES_HORIZONTAL || frame.playerTileY < 0 || frame.playerTileY >= NUM_TILES_VERTICAL)
+        return "player off the maze";
+    int playerCell = frame.playerTileY * NUM_TILES_HORIZONTAL + frame.playerTileX;
+
+    int players = 0;
+    int ghosts = 0;
+    for (int cell = 0; cell < OBSERVATION_PLANE_SIZE; cell++) {
+        players += frame.Plane(PLANE_PLAYER)[cell];
+        for (int g = 0; g < MAX_GHOSTS; g++)
+            ghosts += frame.Plane(PLANE_GHOSTS + g)[cell];
+        if (frame.Plane(PLANE_PELLETS)[cell] && frame.Plane(PLANE_WALLS)[cell])
+            return "pellet inside a wall";
+        if (frame.Plane(PLANE_GHOST_STATE)[cell] != frame.ghostState + 1)
+            return "ghost state plane disagrees with the header";
+    }
+    if (players != 1 || frame.Plane(PLANE_PLAYER)[playerCell] != 1)
+        return "player plane disagrees with the header";
+    if (frame.Plane(PLANE_WALLS)[playerCell])
+        return "player inside a wall";
+    if (ghosts != frame.numGhosts)
+        return "wrong number of ghosts";
+    return NULL;
+}
+
+static unsigned int NextRandom(unsigned int &rng) {
+    rng = rng * 1664525u + 1013904223u;
+    return rng >> 16;
+}
+
+static Orientation ChooseAction(const ObservationFrame &frame, unsigned int &rng) {
+    const uint8_t *walls = frame.Plane(PLANE_WALLS);
+    int start = NextRandom(rng) % 4;
+    for (int i = 0; i < 4; i++) {
+        int d = (start + i) % 4;
+        int x = frame.playerTileX + MazeTablesDetail::STEP_X[d];
+        int y = frame.playerTileY + MazeTablesDetail::STEP_Y[d];
+        if (x >= 0 && x < NUM_TILES_HORIZONTAL && y >= 0 && y < NUM_TILES_VERTICAL && !walls[y * NUM_TILES_HORIZONTAL + x])
+            return (Orientation)d;
+    }
+    return none;
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = OBSERVATION_DEFAULT_NAME;
+    long long maxFrames = -1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-name") == 0) name = argv[i + 1];
+        else if (strcmp(argv[i], "-frames") == 0) maxFrames = atoll(argv[i + 1]);
+        else printf("ignoring unknown option %s\n", argv[i]);
+    }
+
+    ObservationRing ring;
+    double deadline = Now() + ATTACH_TIMEOUT_SECONDS;
+    while (!ring.Attach(name)) {
+        if (Now() > deadline) {
+            printf("no observation ring called %s\n", name);
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    printf("attached to %s: %u slots, %u planes of %ux%u\n", name, ring.header->numSlots, ring.header->planes, ring.header->rows, ring.header->columns);
+
+    unsigned int rng = 12345;
+    uint64_t expected = ring.header->consumed.load();
+    long long frames = 0;
+    long long failures = 0;
+    double reward = 0;
+    long long games = 0;
+    double start = Now();
+    double lastFrame = start;
+    while (maxFrames < 0 || frames < maxFrames) {
+        const ObservationFrame *frame = ring.Next();
+        if (frame == NULL) {
+            if (Now() - lastFrame > IDLE_TIMEOUT_SECONDS)
+                break;
+            std::this_thread::yield();
+            continue;
+        }
+
+        const char *problem = CheckFrame(*frame, expected);
+        if (problem != NULL && failures++ < 10)
+            printf("frame %llu: %s\n", (unsigned long long)expected, problem);
+        reward += frame->reward;
+        games += frame->done;
+
+        ring.SendAction(frame->frame, ChooseAction(*frame, rng));
+        ring.Release();
+        expected++;
+        frames++;
+        lastFrame = Now();
+    }
+    double seconds = lastFrame - start;
+
+    printf("%lld frames in %.3f s (%.0f frames/sec), %lld failed checks\n", frames, seconds, frames / (seconds > 0 ? seconds : 1), failures);
+    printf("%.0f pellets eaten over %lld finished games\n", reward, games);
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,349 @@
+/*******************************************************************************************
+*
+*   PacAI headless runner
+*
+*   Steps the simulation core without a window or raylib, as fast as the host allows.
+*
+*   Build: g++ -std=c++17 -O2 -pthread PacAIHeadless.cpp Simulation.cpp FixedSimulation.cpp
+*          GameState.cpp JunctionGraph.cpp MazeTables.cpp Bitboard.cpp CollisionIndex.cpp
+*          MazeFile.cpp BatchSimulation.cpp ThreadPool.cpp Log.cpp Profiler.cpp MctsAgent.cpp
+*          ObservationRing.cpp ReplayLog.cpp -lrt -o PacAIHeadless
+*   Usage: PacAIHeadless [-steps n] [-dt seconds] [-envs n] [-threads n] [-fixed] [-events]
+*                        [-seed n] [-log file] [-profile file] [-agent ms] [-export name]
+*                        [-record file] [-replay file [-seek tick]] [-maze file]
+*
+*   -fixed runs the deterministic integer simulation (one fixed tick per step, -dt ignored)
+*   and prints a checksum of the final state that should match on every machine. -events
+*   additionally jumps from event to event instead of stepping every tick. -log keeps
+*   decision tracing on and streams it to file in the binary log format. -profile times the
+*   player and AI phases of a single float game and writes their percentiles to file as CSV.
+*   -agent lets the search agent play the fixed simulation with ms of thinking per move,
+*   until it is caught, clears the maze or runs out of steps. -export hands every tick of the
+*   fixed simulation to a trainer over the shared-memory ring called name (see
+*   ObservationRing.h) and steps with the action it sends back; PacAIConsumer is a stand-in.
+*   -record writes the inputs of a -fixed, -events or -agent run to a replay log, and is
+*   refused on any other run. -replay plays a log back at full speed, checking every keyframe
+*   on the way; -seek then jumps back to tick and replays forward again to show the two
+*   agree. -maze plays the float games on a maze file (see MazeFile.h) instead of the stock
+*   maze; the fixed simulation only knows the stock one.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "Simulation.h"
+#include "FixedSimulation.h"
+#include "BatchSimulation.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "MctsAgent.h"
+#include "ObservationRing.h"
+#include "ReplayLog.h"
+#include "MazeFile.h"
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#define DEFAULT_STEPS 1000000
+#define DEFAULT_DELTA_TIME (1.0f / 60.0f)
+#define DEFAULT_SEED 12345
+#define TICKS_PER_INPUT 30
+#define EXPORT_TIMEOUT_SECONDS 5.0
+
+typedef struct HeadlessOptions {
+    long long steps = DEFAULT_STEPS;
+    float deltaTime = DEFAULT_DELTA_TIME;
+    int environments = 1;
+    int threads = 0;
+    bool fixed = false;
+    bool events = false;
+    unsigned int seed = DEFAULT_SEED;
+    const char *logPath = NULL;
+    const char *profilePath = NULL;
+    double agentBudget = 0;
+    const char *exportName = NULL;
+    const char *recordPath = NULL;
+    const char *replayPath = NULL;
+    long long seekTick = -1;
+    const char *mazePath = NULL;
+} HeadlessOptions;
+
+static HeadlessOptions ParseOptions(int argc, char **argv) {
+    HeadlessOptions options;
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : "0";
+        if (strcmp(argv[i], "-steps") == 0) { options.steps = atoll(value); i++; }
+        else if (strcmp(argv[i], "-dt") == 0) { options.deltaTime = (float)atof(value); i++; }
+        else if (strcmp(argv[i], "-envs") == 0) { options.environments = atoi(value); i++; }
+        else if (strcmp(argv[i], "-threads") == 0) { options.threads = atoi(value); i++; }
+        else if (strcmp(argv[i], "-seed") == 0) { options.seed = (unsigned int)strtoul(value, NULL, 10); i++; }
+        else if (strcmp(argv[i], "-log") == 0) { options.logPath = value; i++; }
+        else if (strcmp(argv[i], "-profile") == 0) { options.profilePath = value; i++; }
+        else if (strcmp(argv[i], "-agent") == 0) { options.agentBudget = atof(value) / 1000; i++; }
+        else if (strcmp(argv[i], "-export") == 0) { options.exportName = value; i++; }
+        else if (strcmp(argv[i], "-record") == 0) { options.recordPath = value; i++; }
+        else if (strcmp(argv[i], "-replay") == 0) { options.replayPath = value; i++; }
+        else if (strcmp(argv[i], "-seek") == 0) { options.seekTick = atoll(value); i++; }
+        else if (strcmp(argv[i], "-maze") == 0) { options.mazePath = value; i++; }
+        else if (strcmp(argv[i], "-fixed") == 0) options.fixed = true;
+        else if (strcmp(argv[i], "-events") == 0) options.fixed = options.events = true;
+        else printf("ignoring unknown option %s\n", argv[i]);
+    }
+    return options;
+}
+
+// cheap LCG so the player wanders the maze instead of pinning itself against a wall //
+static Orientation NextInput(unsigned int &rng) {
+    rng = rng * 1664525u + 1013904223u;
+    return (Orientation)((rng >> 16) % 4);
+}
+
+static void Report(const char *label, double total, double seconds) {
+    printf("%s: %.0f steps in %.3f s (%.0f steps/sec)\n", label, total, seconds, total / seconds);
+}
+
+static void CloseLog(FILE *logFile) {
+    if (logFile == NULL)
+        return;
+    LogStop();
+    fclose(logFile);
+    if (LogDropped() > 0)
+        printf("log dropped %llu messages\n", LogDropped());
+}
+
+int main(int argc, char **argv)
+{
+    HeadlessOptions options = ParseOptions(argc, argv);
+    unsigned int rng = options.seed;
+
+    FILE *logFile = options.logPath != NULL ? fopen(options.logPath, "wb") : NULL;
+    if (logFile != NULL) {
+        LogStart(logFile, LOG_FORMAT_BINARY);
+        LogSetLevel(LOG_LEVEL_DEBUG);
+    }
+    else
+        LogSetLevel(LOG_LEVEL_INFO);
+
+    if (options.profilePath != NULL && (options.fixed || options.environments > 1))
+        printf("-profile only applies to a single float game, ignoring it\n");
+
+    if (options.replayPath != NULL) {
+        ReplayPlayer replay;
+        if (!replay.Open(options.replayPath)) {
+            printf("could not open replay %s\n", options.replayPath);
+            CloseLog(logFile);
+            return 1;
+        }
+        FixedSimulation sim;
+        replay.Seek(sim, 0);
+
+        auto start = std::chrono::steady_clock::now();
+        bool matched = replay.Play(sim, replay.Ticks());
+        auto end = std::chrono::steady_clock::now();
+        Report("replay", (double)sim.state.tick, std::chrono::duration<double>(end - start).count());
+        printf("tick %llu, checksum %016llx%s\n", (unsigned long long)sim.state.tick, (unsigned long long)sim.Checksum(), matched ? "" : ", diverged from the log");
+
+        if (options.seekTick >= 0 && matched) {
+            // rewind to the requested tick, then fast-forward to the end again //
+            uint64_t final = sim.Checksum();
+            start = std::chrono::steady_clock::now();
+            replay.Seek(sim, (uint64_t)options.seekTick);
+            auto seeked = std::chrono::steady_clock::now();
+            printf("seek to tick %llu in %.3f ms, checksum %016llx\n", (unsigned long long)sim.state.tick, std::chrono::duration<double, std::milli>(seeked - start).count(), (unsigned long long)sim.Checksum());
+            matched = replay.Play(sim, replay.Ticks()) && sim.Checksum() == final;
+            printf("replayed from there to tick %llu: %s\n", (unsigned long long)sim.state.tick, matched ? "matches" : "differs");
+        }
+        CloseLog(logFile);
+        return matched ? 0 : 1;
+    }
+
+    // only the fixed simulation's inputs replay, and -export hands them to the trainer instead //
+    if (options.recordPath != NULL && (options.exportName != NULL || (!options.fixed && options.agentBudget <= 0))) {
+        printf("-record needs -fixed, -events or -agent; float and exported runs can't be recorded\n");
+        CloseLog(logFile);
+        return 1;
+    }
+    ReplayRecorder recorder;
+    if (options.recordPath != NULL && !recorder.Open(options.recordPath, options.seed)) {
+        CloseLog(logFile);
+        return 1;
+    }
+
+    if (options.exportName != NULL) {
+        ObservationRing ring;
+        if (!ring.Create(options.exportName, OBSERVATION_DEFAULT_SLOTS, DEFAULT_BITBOARD)) {
+            CloseLog(logFile);
+            return 1;
+        }
+        FixedSimulation sim;
+        sim.Reset(options.seed);
+
+        // Lock-step: publish a tick, wait for the trainer's answer, apply it //
+        long long games = 1;
+        bool stalled = false;
+        auto start = std::chrono::steady_clock::now();
+        for (long long i = 0; i < options.steps && !stalled; i++) {
+            bool done = sim.state.PlayerCaught() || sim.state.PelletsLeft() == 0;
+            uint64_t frame = ring.header->published.load();
+            auto waitStart = std::chrono::steady_clock::now();
+            int action = NO_ACTION;
+            while (!ring.Publish(sim, done) && !stalled)
+                stalled = std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count() > EXPORT_TIMEOUT_SECONDS;
+            while (!stalled && (action = ring.PollAction(frame)) == NO_ACTION) {
+                std::this_thread::yield();
+                stalled = std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count() > EXPORT_TIMEOUT_SECONDS;
+            }
+            if (done) {
+                sim.Reset(options.seed + (unsigned int)games++);
+                continue;
+            }
+            sim.Step(action >= up && action <= none ? (Orientation)action : none);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        if (stalled)
+            printf("trainer stopped answering after %llu frames\n", (unsigned long long)ring.header->published.load());
+        Report("export", (double)ring.header->published.load(), std::chrono::duration<double>(end - start).count());
+        printf("%lld games\n", games);
+        ring.Close();
+        CloseLog(logFile);
+        return stalled ? 1 : 0;
+    }
+
+    if (options.agentBudget > 0) {
+        ThreadPool pool(options.threads);
+        MctsAgent agent(pool, options.agentBudget);
+        FixedSimulation sim;
+        sim.Reset(options.seed);
+        int pellets = sim.state.PelletsLeft();
+
+        unsigned long long iterations = 0;
+        bool caught = false;
+        auto start = std::chrono::steady_clock::now();
+        while ((long long)sim.state.tick < options.steps && sim.state.PelletsLeft() > 0 && !caught) {
+            Orientation inp = agent.Decide(sim);
+            iterations += agent.lastIterations;
+            for (int i = 0; i < MCTS_MOVE_TICKS && !caught; i++) {
+                recorder.Record(sim.state, inp);
+                sim.Step(inp);
+                caught = sim.state.PlayerCaught();
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        printf("agent on %d threads: %llu decisions, %.0f rollouts per decision\n", pool.Size(), agent.decisions, (double)iterations / agent.decisions);
+        printf("%s after %llu ticks, %d of %d pellets eaten in %.3f s\n", caught ? "caught" : sim.state.PelletsLeft() == 0 ? "cleared" : "stopped",
+               (unsigned long long)sim.state.tick, pellets - sim.state.PelletsLeft(), pellets, std::chrono::duration<double>(end - start).count());
+        CloseLog(logFile);
+        return 0;
+    }
+
+    if (options.fixed) {
+        FixedSimulation sim;
+        sim.Reset(options.seed);
+        Orientation inp = left;
+
+        long long calls = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (long long i = 0; i < options.steps; ) {
+            if (i % TICKS_PER_INPUT == 0)
+                inp = NextInput(rng);
+            if (options.events) {
+                // hold the input up to the next change so the result matches per-tick stepping //
+                long long untilInput = TICKS_PER_INPUT - i % TICKS_PER_INPUT;
+                long long untilEnd = options.steps - i;
+                long long limit = untilInput < untilEnd ? untilInput : untilEnd;
+                limit = options.recordPath != NULL && recorder.TicksToKeyframe() < limit ? recorder.TicksToKeyframe() : limit;
+                GameState before = sim.state;
+                uint32_t ticks = sim.StepToEvent(inp, (uint32_t)limit);
+                recorder.Record(before, inp, ticks);
+                i += ticks;
+            }
+            else {
+                recorder.Record(sim.state, inp);
+                sim.Step(inp);
+                i++;
+            }
+            calls++;
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        Report(options.events ? "events" : "fixed", (double)options.steps, std::chrono::duration<double>(end - start).count());
+        printf("%lld simulation calls\n", calls);
+        printf("player tile (%d, %d), blinky tile (%d, %d), checksum %016llx\n", sim.state.player.TileX(), sim.state.player.TileY(), sim.state.ghosts[0].TileX(), sim.state.ghosts[0].TileY(), (unsigned long long)sim.Checksum());
+        CloseLog(logFile);
+        return 0;
+    }
+
+    MazeCache mazes;
+    std::shared_ptr<const Maze> maze = options.mazePath != NULL ? mazes.Load(options.mazePath) : NULL;
+    if (options.mazePath != NULL && maze == NULL) {
+        CloseLog(logFile);
+        return 1;
+    }
+
+    if (options.environments <= 1) {
+        static Profiler profiler;
+        profiler.Clear();
+        Simulation sim;
+        if (maze != NULL)
+            sim.UseMaze(*maze);
+        sim.Reset();
+        sim.profiler = options.profilePath != NULL ? &profiler : NULL;
+        Orientation inp = left;
+
+        auto start = std::chrono::steady_clock::now();
+        for (long long i = 0; i < options.steps; i++) {
+            if (i % TICKS_PER_INPUT == 0)
+                inp = NextInput(rng);
+            sim.Step(inp, options.deltaTime);
+            if (sim.profiler != NULL) {
+                profiler.Flush(PHASE_PLAYER);
+                profiler.Flush(PHASE_AI);
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        Report("single", (double)options.steps, std::chrono::duration<double>(end - start).count());
+        printf("player tile (%d, %d), blinky tile (%d, %d)\n", sim.player.currentTileX, sim.player.currentTileY, sim.ghosts.currentTileX[0], sim.ghosts.currentTileY[0]);
+        if (sim.caughtBy != NO_COLLISION)
+            printf("caught by %s in slot %d\n", GHOST_PERSONALITIES[sim.ghosts.personality[sim.caughtBy]].name, sim.caughtBy);
+        if (options.profilePath != NULL) {
+            profiler.WriteCsv(stdout);
+            if (!profiler.WriteCsv(options.profilePath))
+                printf("could not write %s\n", options.profilePath);
+        }
+        CloseLog(logFile);
+        return 0;
+    }
+
+    ThreadPool pool(options.threads);
+    BatchSimulation batch(options.environments, pool);
+    if (maze != NULL)
+        batch.UseMaze(*maze);
+    batch.Reset();
+    std::vector<Orientation> inputs(options.environments, left);
+
+    auto start = std::chrono::steady_clock::now();
+    for (long long i = 0; i < options.steps; i++) {
+        if (i % TICKS_PER_INPUT == 0) {
+            for (int env = 0; env < options.environments; env++)
+                inputs[env] = NextInput(rng);
+        }
+        batch.Step(inputs.data(), options.deltaTime);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    printf("%d environments on %d threads\n", options.environments, pool.Size());
+    Report("batch", (double)options.steps * options.environments, std::chrono::duration<double>(end - start).count());
+    int caught = 0;
+    for (int env = 0; env < options.environments; env++)
+        caught += batch.caughtBy[env] != NO_COLLISION;
+    printf("%d of %d games caught\n", caught, options.environments);
+
+    CloseLog(logFile);
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*******************************************************************************************
+*
+*   PacAI profiler
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "Profiler.h"
+#include <string.h>
+#include <chrono>
+#include <thread>
+#if defined(PROFILER_USE_RDTSC) && defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+const char *PHASE_NAMES[PHASE_COUNT] = { "input", "player", "ai", "render" };
+
+static int BucketFor(uint64_t value) {
+    if (value < HISTOGRAM_LINEAR)
+        return (int)value;
+    int msb = 63 - __builtin_clzll(value);
+    int sub = (int)(value >> (msb - HISTOGRAM_SUB_BITS)) & ((1 << HISTOGRAM_SUB_BITS) - 1);
+    return HISTOGRAM_LINEAR + (msb - HISTOGRAM_SUB_BITS - 1) * (1 << HISTOGRAM_SUB_BITS) + sub;
+}
+
+static uint64_t BucketLowerBound(int bucket) {
+    if (bucket < HISTOGRAM_LINEAR)
+        return bucket;
+    int offset = bucket - HISTOGRAM_LINEAR;
+    int msb = offset / (1 << HISTOGRAM_SUB_BITS) + HISTOGRAM_SUB_BITS + 1;
+    int sub = offset % (1 << HISTOGRAM_SUB_BITS);
+    return ((uint64_t)((1 << HISTOGRAM_SUB_BITS) + sub)) << (msb - HISTOGRAM_SUB_BITS);
+}
+
+void Histogram::Clear() {
+    memset(this, 0, sizeof(*this));
+}
+
+void Histogram::Record(uint64_t value) {
+    counts[BucketFor(value)]++;
+    total++;
+    sum += value;
+    max = value > max ? value : max;
+}
+
+uint64_t Histogram::Percentile(double percentile) const {
+    if (total == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank)
+            return BucketLowerBound(i);
+    }
+    return max;
+}
+
+void Profiler::Clear() {
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        phases[i].Clear();
+        pending[i] = 0;
+    }
+}
+
+void Profiler::Flush(ProfilePhase phase) {
+    Record(phase, pending[phase]);
+    pending[phase] = 0;
+}
+
+void Profiler::End(ProfilePhase phase, uint64_t start) {
+    Record(phase, ProfilerTicksToNanoseconds(ProfilerNow() - start));
+}
+
+void Profiler::WriteCsv(FILE *file) const {
+    fprintf(file, "phase,samples,mean_ns,p50_ns,p99_ns,max_ns\n");
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const Histogram &h = phases[i];
+        fprintf(file, "%s,%llu,%.0f,%llu,%llu,%llu\n", PHASE_NAMES[i], (unsigned long long)h.total, h.Mean(),
+                (unsigned long long)h.Percentile(50), (unsigned long long)h.Percentile(99), (unsigned long long)h.max);
+    }
+}
+
+bool Profiler::WriteCsv(const char *path) const {
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+        return false;
+    WriteCsv(file);
+    fclose(file);
+    return true;
+}
+
+#if defined(PROFILER_USE_RDTSC) && defined(__x86_64__)
+
+// TSC ticks per nanosecond, measured once against steady_clock //
+static double CalibrateTsc(void) {
+    auto wallStart = std::chrono::steady_clock::now();
+    uint64_t tscStart = __rdtsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t tscEnd = __rdtsc();
+    auto wallEnd = std::chrono::steady_clock::now();
+    return (double)(tscEnd - tscStart) / std::chrono::duration<double, std::nano>(wallEnd - wallStart).count();
+}
+
+uint64_t ProfilerNow(void) {
+    return __rdtsc();
+}
+
+uint64_t ProfilerTicksToNanoseconds(uint64_t ticks) {
+    static const double ticksPerNanosecond = CalibrateTsc();
+    return (uint64_t)(ticks / ticksPerNanosecond);
+}
+
+#else
+
+uint64_t ProfilerNow(void) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t ProfilerTicksToNanoseconds(uint64_t ticks) {
+    return ticks;
+}
+
+#endif
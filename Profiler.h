@@ -0,0 +1,83 @@
+/*******************************************************************************************
+*
+*   PacAI profiler
+*
+*   Scoped per-phase timers feeding log-linear histograms (8 buckets per power of two, so
+*   percentiles are within 12.5%), cheap enough to leave on every frame. Timing uses the
+*   TSC on x86-64 when PROFILER_USE_RDTSC is defined, steady_clock otherwise.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_LINEAR (1 << (HISTOGRAM_SUB_BITS + 1))
+#define HISTOGRAM_BUCKETS (HISTOGRAM_LINEAR + (64 - HISTOGRAM_SUB_BITS - 1) * (1 << HISTOGRAM_SUB_BITS))
+
+typedef enum ProfilePhase {
+    PHASE_INPUT,
+    PHASE_PLAYER,
+    PHASE_AI,
+    PHASE_RENDER,
+    PHASE_COUNT
+} ProfilePhase;
+
+extern const char *PHASE_NAMES[PHASE_COUNT];
+
+typedef struct Histogram {
+    uint32_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t max;
+
+    void Clear();
+    void Record(uint64_t value);
+    uint64_t Percentile(double percentile) const;
+    double Mean() const { return total > 0 ? (double)sum / total : 0; }
+} Histogram;
+
+typedef struct Profiler {
+    Histogram phases[PHASE_COUNT];
+    uint64_t pending[PHASE_COUNT];                      // nanoseconds Add()ed since the last Flush()
+
+    void Clear();
+    void Record(ProfilePhase phase, uint64_t nanoseconds) { phases[phase].Record(nanoseconds); }
+    void End(ProfilePhase phase, uint64_t start);       // start from ProfilerNow()
+
+    // A phase that runs in pieces, such as once per simulation tick, is Add()ed up and then
+    // Flush()ed as one sample per frame, zero if it didn't run, so it compares with the rest //
+    void Add(ProfilePhase phase, uint64_t nanoseconds) { pending[phase] += nanoseconds; }
+    void Flush(ProfilePhase phase);
+
+    // One row per phase: samples, mean, p50, p99, max, all in nanoseconds //
+    void WriteCsv(FILE *file) const;
+    bool WriteCsv(const char *path) const;
+} Profiler;
+
+uint64_t ProfilerNow(void);                     // ticks of whichever clock is in use
+uint64_t ProfilerTicksToNanoseconds(uint64_t ticks);
+
+// Times the enclosing scope into profiler (which may be NULL) //
+typedef struct ScopedPhaseTimer {
+    ScopedPhaseTimer(Profiler *profiler, ProfilePhase phase) : profiler(profiler), phase(phase), start(profiler != NULL ? ProfilerNow() : 0) {}
+    ~ScopedPhaseTimer() {
+        if (profiler != NULL)
+            profiler->Record(phase, ProfilerTicksToNanoseconds(ProfilerNow() - start));
+    }
+
+    Profiler *profiler;
+    ProfilePhase phase;
+    uint64_t start;
+} ScopedPhaseTimer;
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_PHASE(profiler, phase) ScopedPhaseTimer PROFILE_CONCAT(phaseTimer, __LINE__)((profiler), (phase))
+
+#endif
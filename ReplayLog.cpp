@@ -0,0 +1,180 @@
+/*******************************************************************************************
+*
+*   PacAI replay log
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "ReplayLog.h"
+#include "Log.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool ReplayRecorder::Open(const char *path, uint32_t seed, uint32_t keyframeInterval) {
+    Close();
+    if (keyframeInterval == 0 || keyframeInterval % 2 != 0) {
+        LogMessage(LOG_LEVEL_ERROR, "REPLAY: Keyframe interval %u must be even", keyframeInterval);
+        return false;
+    }
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        LogMessage(LOG_LEVEL_ERROR, "REPLAY: Could not create %s", path);
+        return false;
+    }
+
+    ReplayHeader header = { REPLAY_MAGIC, REPLAY_VERSION, seed, keyframeInterval, 0 };
+    fwrite(&header, sizeof(header), 1, file);
+    interval = keyframeInterval;
+    recorded = 0;
+    pending = -1;
+    return true;
+}
+
+void ReplayRecorder::Record(const GameState &state, Orientation input, uint32_t ticks) {
+    if (file == NULL)
+        return;
+    for (uint32_t i = 0; i < ticks; i++, recorded++) {
+        // chunks start on a byte boundary since the interval is even //
+        if (recorded % interval == 0)
+            fwrite(&state, sizeof(GameState), 1, file);
+        if (pending < 0)
+            pending = input;
+        else {
+            fputc(pending | (input << 4), file);
+            pending = -1;
+        }
+    }
+}
+
+void ReplayRecorder::Close() {
+    if (file == NULL)
+        return;
+    if (pending >= 0)
+        fputc(pending | (REPLAY_NO_INPUT << 4), file);
+    fseek(file, offsetof(ReplayHeader, ticks), SEEK_SET);
+    fwrite(&recorded, sizeof(recorded), 1, file);
+    fclose(file);
+    file = NULL;
+}
+
+size_t ReplayPlayer::ChunkSize() const {
+    return sizeof(GameState) + header->keyframeInterval / 2;
+}
+
+const uint8_t *ReplayPlayer::Chunk(uint64_t index) const {
+    return (const uint8_t *)mapping + sizeof(ReplayHeader) + index * ChunkSize();
+}
+
+void ReplayPlayer::Keyframe(uint64_t index, GameState &state) const {
+    // chunks aren't aligned for GameState, so copy it out //
+    memcpy((void *)&state, Chunk(index), sizeof(GameState));
+}
+
+bool ReplayPlayer::Open(const char *path) {
+    Close();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(ReplayHeader)) {
+        close(fd);
+        LogMessage(LOG_LEVEL_ERROR, "REPLAY: %s is too short to be a replay log", path);
+        return false;
+    }
+    void *memory = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+        return false;
+
+    mapping = memory;
+    mappingSize = info.st_size;
+    header = (const ReplayHeader *)mapping;
+    if (header->magic != REPLAY_MAGIC || header->version != REPLAY_VERSION || header->keyframeInterval == 0 || header->keyframeInterval % 2 != 0) {
+        LogMessage(LOG_LEVEL_ERROR, "REPLAY: %s is not a replay log", path);
+        Close();
+        return false;
+    }
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+
+    // The most ticks the body can hold: whole chunks, then the inputs after a last keyframe //
+    size_t body = mappingSize - sizeof(ReplayHeader);
+    uint64_t chunks = body / ChunkSize();
+    size_t tail = body % ChunkSize();
+    uint64_t capacity = chunks * header->keyframeInterval + (tail > sizeof(GameState) ? (tail - sizeof(GameState)) * 2 : 0);
+
+    // A log from a run that never closed has no tick count; recover it from the size. One
+    // that claims more than it holds was cut short, and only plays what survived //
+    ticks = header->ticks;
+    if (ticks > capacity) {
+        LogMessage(LOG_LEVEL_WARNING, "REPLAY: %s claims %llu ticks but holds %llu", path, (unsigned long long)ticks, (unsigned long long)capacity);
+        ticks = capacity;
+    }
+    if (ticks == 0) {
+        ticks = capacity;
+        while (ticks > 0 && Input(ticks - 1) == (Orientation)REPLAY_NO_INPUT)
+            ticks--;
+    }
+    return true;
+}
+
+void ReplayPlayer::Close() {
+    if (mapping == NULL)
+        return;
+    munmap(mapping, mappingSize);
+    mapping = NULL;
+    header = NULL;
+    ticks = 0;
+}
+
+Orientation ReplayPlayer::Input(uint64_t tick) const {
+    uint64_t offset = tick % header->keyframeInterval;
+    uint8_t packed = Chunk(tick / header->keyframeInterval)[sizeof(GameState) + offset / 2];
+    return (Orientation)((offset & 1) ? packed >> 4 : packed & 0xF);
+}
+
+// Replays [from, to) on sim, jumping through runs of held input with StepToEvent() //
+static void Advance(const ReplayPlayer &player, FixedSimulation &sim, uint64_t from, uint64_t to) {
+    for (uint64_t t = from; t < to; ) {
+        Orientation input = player.Input(t);
+        uint64_t run = 1;
+        while (t + run < to && run < UINT32_MAX && player.Input(t + run) == input)
+            run++;
+        for (uint64_t end = t + run; t < end; )
+            t += sim.StepToEvent(input, (uint32_t)(end - t));
+    }
+}
+
+void ReplayPlayer::Seek(FixedSimulation &sim, uint64_t tick) const {
+    tick = tick < ticks ? tick : ticks;
+    uint64_t index = tick / header->keyframeInterval;
+    if (index > 0 && index * header->keyframeInterval >= ticks)
+        index--;                             // the log ends on a boundary with no keyframe after it
+
+    sim.Reset(header->seed);
+    if (index * header->keyframeInterval < ticks)
+        Keyframe(index, sim.state);
+    Advance(*this, sim, index * header->keyframeInterval, tick);
+}
+
+bool ReplayPlayer::Play(FixedSimulation &sim, uint64_t tick) const {
+    tick = tick < ticks ? tick : ticks;
+    GameState keyframe;
+    for (uint64_t t = sim.state.tick; t < tick; ) {
+        if (t % header->keyframeInterval == 0) {
+            Keyframe(t / header->keyframeInterval, keyframe);
+            if (keyframe.hash != sim.state.hash || keyframe.tick != sim.state.tick) {
+                LogMessage(LOG_LEVEL_WARNING, "REPLAY: Diverged from the log at tick %llu", (unsigned long long)t);
+                return false;
+            }
+        }
+        uint64_t boundary = (t / header->keyframeInterval + 1) * header->keyframeInterval;
+        uint64_t end = boundary < tick ? boundary : tick;
+        Advance(*this, sim, t, end);
+        t = end;
+    }
+    return true;
+}
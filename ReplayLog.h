@@ -0,0 +1,85 @@
+/*******************************************************************************************
+*
+*   PacAI replay log
+*
+*   Records a fixed simulation run as its seed plus one input per tick, packed two to a
+*   byte, with a full GameState keyframe every keyframeInterval ticks. Chunks (keyframe then
+*   the inputs up to the next one) all have the same size, so a player that maps the file
+*   finds any keyframe by arithmetic: seeking restores the nearest keyframe at or before the
+*   target and re-simulates the rest, which also makes rewinding cheap.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef REPLAY_LOG_H
+#define REPLAY_LOG_H
+
+#include "FixedSimulation.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define REPLAY_MAGIC 0x52434150u             // "PACR"
+#define REPLAY_VERSION 3
+#define REPLAY_DEFAULT_INTERVAL 1024         // ticks per keyframe, must be even
+#define REPLAY_NO_INPUT 0xF                  // nibble padding the last byte of a log
+
+typedef struct ReplayHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seed;
+    uint32_t keyframeInterval;
+    uint64_t ticks;                          // 0 until the recorder closes cleanly
+} ReplayHeader;
+
+typedef struct ReplayRecorder {
+    ReplayRecorder() : file(NULL), interval(0), recorded(0), pending(0) {}
+    ~ReplayRecorder() { Close(); }
+
+    // Open straight after sim.Reset(seed), before the first tick //
+    bool Open(const char *path, uint32_t seed, uint32_t keyframeInterval = REPLAY_DEFAULT_INTERVAL);
+
+    // ticks of input held, starting from state; a run must not cross a keyframe boundary,
+    // see TicksToKeyframe() //
+    void Record(const GameState &state, Orientation input, uint32_t ticks = 1);
+    uint32_t TicksToKeyframe() const { return interval - (uint32_t)(recorded % interval); }
+
+    void Close();
+
+private:
+    FILE *file;
+    uint32_t interval;
+    uint64_t recorded;
+    int pending;                             // low nibble waiting for its partner, or -1
+} ReplayRecorder;
+
+typedef struct ReplayPlayer {
+    ReplayPlayer() : mapping(NULL), mappingSize(0), ticks(0), header(NULL) {}
+    ~ReplayPlayer() { Close(); }
+
+    bool Open(const char *path);
+    void Close();
+
+    uint64_t Ticks() const { return ticks; }
+    Orientation Input(uint64_t tick) const;
+
+    // Resets sim to the recorded seed and moves it to tick //
+    void Seek(FixedSimulation &sim, uint64_t tick) const;
+
+    // Plays sim forward from its current tick to tick (clamped to the log), checking it
+    // against every keyframe passed on the way. Returns false on the first mismatch //
+    bool Play(FixedSimulation &sim, uint64_t tick) const;
+
+private:
+    size_t ChunkSize() const;
+    const uint8_t *Chunk(uint64_t index) const;
+    void Keyframe(uint64_t index, GameState &state) const;
+
+    void *mapping;
+    size_t mappingSize;
+    uint64_t ticks;
+    const ReplayHeader *header;
+} ReplayPlayer;
+
+#endif
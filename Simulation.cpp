@@ -0,0 +1,847 @@
+/*******************************************************************************************
+*
+*   PacAI simulation core
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "Simulation.h"
+#include "MazeTables.h"
+#include "Bitboard.h"
+#include "CollisionIndex.h"
+#include "MazeFile.h"
+#include "Log.h"
+#include "Profiler.h"
+#include <math.h>
+#include <limits>
+#include <algorithm>
+
+#define SPAWN_STRIDE 97                     // walkable tiles skipped between repeated ghosts' spawns
+#define TARGET_BLOCK 8                      // ghosts UpdateGhostTargets() handles per vectorised pass
+
+const GhostPersonality GHOST_PERSONALITIES[NUM_PERSONALITIES] = {
+    //  name        scatter   lead scale pivot shy  start     heading
+    { "Blinky",     26, 0,    0,   1,    0,    0,   11, 13,   left  },
+    { "Pinky",      1, 0,     4,   1,    0,    0,   11, 14,   right },
+    { "Inky",       27, 31,   2,   2,    0,    0,   17, 12,   left  },
+    { "Clyde",      0, 31,    0,   1,    0,    8,   17, 15,   right },
+    { "Ambusher",   13, 0,    8,   1,    0,    0,   5, 13,    left  },
+    { "Flanker",    13, 31,   0,   3,    1,    0,   29, 13,   right },
+};
+
+const GhostModePhase GHOST_MODE_SCHEDULE[NUM_MODE_PHASES] = {
+    { scatter, 7 }, { chase, 20 }, { scatter, 7 }, { chase, 20 },
+    { scatter, 5 }, { chase, 20 }, { scatter, 5 }, { chase, 0 },
+};
+
+const MazeLayout DEFAULT_LAYOUT = { NUM_TILES_VERTICAL, NUM_TILES_HORIZONTAL, 1, { { STARTING_COLUMN, STARTING_ROW } }, 0, {}, 0, {}, {} };
+
+static const GhostPersonalityId DEFAULT_ROSTER[] = { BLINKY, PINKY, INKY, CLYDE };
+
+Vector2 CalculatePositionBasedOnTile(int row, int column, float cellSize){
+    return Vector2{MAZE_ORIGIN_X + (column * cellSize) + (cellSize / 2), MAZE_ORIGIN_Y + (row * cellSize) + (cellSize / 2)};
+}
+
+void SetCurrentTileForActor(Actor &actor, float cellSize) {
+    actor.currentTileX = floor((actor.centroid.x - MAZE_ORIGIN_X) / cellSize);
+    actor.currentTileY = floor((actor.centroid.y - MAZE_ORIGIN_Y) / cellSize);
+}
+
+bool IsTraversable(const Actor &actor, Orientation direction, float deltaTime, float cellSize, const int (&grid)[NUM_TILES_VERTICAL][NUM_TILES_HORIZONTAL]) {
+
+    float theoreticalPositionX;
+    float theoreticalPositionY;
+    int targetTileX;
+    int targetTileY;
+
+    if (direction == left) {
+        theoreticalPositionX = actor.centroid.x - actor.speed * deltaTime;
+        theoreticalPositionY = actor.centroid.y;
+        targetTileX = floor((theoreticalPositionX - MAZE_ORIGIN_X) / cellSize);
+        targetTileY = actor.currentTileY;
+
+        // verify target tile is within grid bounds //
+        if (targetTileX > -1 && targetTileX < NUM_TILES_HORIZONTAL) {
+
+            // actor can only move to a tile which is not an obstacle //
+            if (grid[targetTileY][targetTileX] == 1) {
+
+                if (actor.orientation == left || actor.orientation == right || actor.orientation == none) {
+
+                    // if actor is approaching a barrier, we don't want it to proceed past the centroid of its target tile //
+                    if (!(grid[targetTileY][targetTileX - 1] == 0 && actor.centroid.x <= MAZE_ORIGIN_X + targetTileX * cellSize + (cellSize / 2))) {
+                        return true;
+                    }
+                }
+
+                // if moving vertically, only allow horizontal turn if actor is level with target tile's centroid //
+                else if (fabsf(theoreticalPositionY - (MAZE_ORIGIN_Y + targetTileY * cellSize + (cellSize / 2))) < SWEEP_EPSILON) {
+
+
+                    if (targetTileX - 1 > 0 && grid[targetTileY][targetTileX - 1] == 1) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    else if (direction == right) {
+        theoreticalPositionX = actor.centroid.x + actor.speed * deltaTime;
+        theoreticalPositionY = actor.centroid.y;
+        targetTileX = floor((theoreticalPositionX - MAZE_ORIGIN_X) / cellSize);
+        targetTileY = actor.currentTileY;
+
+        // verify target tile is within grid bounds //
+        if (targetTileX > -1 && targetTileX < NUM_TILES_HORIZONTAL) {
+
+            // actor can only move to a tile which is not an obstacle //
+            if (grid[targetTileY][targetTileX] == 1) {
+
+                if (actor.orientation == left || actor.orientation == right || actor.orientation == none) {
+
+                    // if actor is approaching a barrier, we don't want it to proceed past the centroid of its target tile //
+                    if (!(grid[targetTileY][targetTileX + 1] == 0 && actor.centroid.x >= MAZE_ORIGIN_X + targetTileX * cellSize + (cellSize / 2))) {
+                        return true;
+                    }
+                }
+
+                // if moving vertically, only allow horizontal turn if actor is level with target tile's centroid //
+                else if (fabsf(theoreticalPositionY - (MAZE_ORIGIN_Y + targetTileY * cellSize + (cellSize / 2))) < SWEEP_EPSILON) {
+
+                    if (targetTileX + 1 < NUM_TILES_HORIZONTAL && grid[targetTileY][targetTileX + 1] == 1) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    else if (direction == up) {
+        theoreticalPositionX = actor.centroid.x;
+        theoreticalPositionY = actor.centroid.y - actor.speed * deltaTime;
+        targetTileX = actor.currentTileX;
+        targetTileY = floor((theoreticalPositionY - MAZE_ORIGIN_Y) / cellSize);
+
+        // verify target tile is within grid bounds //
+        if (targetTileY > -1 && targetTileY < NUM_TILES_VERTICAL) {
+
+            // actor can only move to a tile which is not an obstacle //
+            if (grid[targetTileY][targetTileX] == 1) {
+
+                if (actor.orientation == up || actor.orientation == down || actor.orientation == none) {
+
+                    // if actor is approaching a barrier, we don't want it to proceed past the centroid of its target tile //
+                    if (!(grid[targetTileY - 1][targetTileX] == 0 && actor.centroid.y <= MAZE_ORIGIN_Y + targetTileY * cellSize + (cellSize / 2))) {
+                        return true;
+                    }
+                }
+
+                // if moving horizontally, only allow vertical turn if actor is level with target tile's centroid //
+                else if (fabsf(theoreticalPositionX - (MAZE_ORIGIN_X + targetTileX * cellSize + (cellSize / 2))) < SWEEP_EPSILON) {
+
+                        if (targetTileY - 1 > 0 && grid[targetTileY - 1][targetTileX] == 1) {
+                            return true;
+                        }
+                }
+            }
+        }
+    }
+    else if (direction == down) {
+        theoreticalPositionX = actor.centroid.x;
+        theoreticalPositionY = actor.centroid.y + actor.speed * deltaTime;
+        targetTileX = actor.currentTileX;
+        targetTileY = floor((theoreticalPositionY - MAZE_ORIGIN_Y) / cellSize);
+
+        // verify target tile is within grid bounds //
+        if (targetTileY > -1 && targetTileY < NUM_TILES_VERTICAL) {
+
+            // actor can only move to a tile which is not an obstacle //
+            if (grid[targetTileY][targetTileX] == 1) {
+
+                if (actor.orientation == up || actor.orientation == down || actor.orientation == none) {
+
+                    // if actor is approaching a barrier, we don't want it to proceed past the centroid of its target tile //
+                    if (!(grid[targetTileY + 1][targetTileX] == 0 && actor.centroid.y >= MAZE_ORIGIN_Y + targetTileY * cellSize + (cellSize / 2))) {
+                        return true;
+                    }
+                }
+
+                // if moving horizontally, only allow vertical turn if actor is level with target tile's centroid //
+                else if (fabsf(theoreticalPositionX - (MAZE_ORIGIN_X + targetTileX * cellSize + (cellSize / 2))) < SWEEP_EPSILON) {
+
+                        if (targetTileY + 1 < NUM_TILES_VERTICAL && grid[targetTileY + 1][targetTileX] == 1) {
+                            return true;
+                        }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+void MoveActor(Actor &actor, Orientation orientation, float deltaTime, float cellSize) {
+    if (orientation == left)
+        actor.centroid.x = actor.centroid.x - actor.speed * deltaTime;
+    else if (orientation == right)
+        actor.centroid.x = actor.centroid.x + actor.speed * deltaTime;
+    else if (orientation == up)
+        actor.centroid.y = actor.centroid.y - actor.speed * deltaTime;
+    else if (orientation == down)
+        actor.centroid.y = actor.centroid.y + actor.speed * deltaTime;
+    actor.orientation = orientation;
+    SetCurrentTileForActor(actor, cellSize);
+}
+
+bool IsReversal(Orientation actorDirection, Orientation newDirection) {
+    if (actorDirection == left && newDirection == right)
+        return true;
+    else if (actorDirection == right && newDirection == left)
+        return true;
+    else if (actorDirection == up && newDirection == down)
+        return true;
+    else if (actorDirection == down && newDirection == up)
+        return true;
+    return false;
+}
+
+
+static float Distance(Vector2 a, Vector2 b) {
+    float dx = a.x - b.x;
+    float dy = a.y - b.y;
+    return sqrtf(dx * dx + dy * dy);
+}
+
+void UpdatePlayer(Actor &player, Orientation input, float deltaTime, float cellSize, const MazeBitboard &board) {
+    if (IsTraversable(player, input, deltaTime, cellSize, board))
+        MoveActor(player, input, deltaTime, cellSize);
+    else if (IsTraversable(player, player.orientation, deltaTime, cellSize, board))
+        MoveActor(player, player.orientation, deltaTime, cellSize);
+    else
+        player.orientation = none;
+}
+
+void ChooseGhostDirection(Ghost &ghost, float cellSize, const Grid &grid) {
+    static const Orientation directions[4] { up, left, down, right };
+    Vector2 targetPosition = CalculatePositionBasedOnTile(ghost.targetTileY, ghost.targetTileX, cellSize);
+
+    float minDistance = std::numeric_limits<float>::max();
+    for (int i = 0; i < 4; i++) {
+        if (IsReversal(ghost.orientation, directions[i])) {
+            continue;
+        }
+
+        if (directions[i] == left) {
+            if (grid[ghost.nextTileY][ghost.nextTileX - 1] == 1) {
+                float dist = Distance(CalculatePositionBasedOnTile(ghost.nextTileY, ghost.nextTileX - 1, cellSize), targetPosition);
+                if (dist < minDistance) {
+                    minDistance = dist;
+                    ghost.pendingDirection = left;
+                    ghost.nextNextTileX = ghost.nextTileX - 1;
+                    ghost.nextNextTileY = ghost.nextTileY;
+                    LOG_MESSAGE(LOG_LEVEL_DEBUG, "left");
+                }
+            }
+        }
+        else if (directions[i] == right) {
+            if (grid[ghost.nextTileY][ghost.nextTileX + 1] == 1) {
+                float dist = Distance(CalculatePositionBasedOnTile(ghost.nextTileY, ghost.nextTileX + 1, cellSize), targetPosition);
+                if (dist < minDistance) {
+                    minDistance = dist;
+                    ghost.pendingDirection = right;
+                    ghost.nextNextTileX = ghost.nextTileX + 1;
+                    ghost.nextNextTileY = ghost.nextTileY;
+                    LOG_MESSAGE(LOG_LEVEL_DEBUG, "right");
+                }
+            }
+        }
+        else if (directions[i] == up) {
+            if (grid[ghost.nextTileY - 1][ghost.nextTileX] == 1) {
+                float dist = Distance(CalculatePositionBasedOnTile(ghost.nextTileY - 1, ghost.nextTileX, cellSize), targetPosition);
+                if (dist < minDistance) {
+                    minDistance = dist;
+                    ghost.pendingDirection = up;
+                    ghost.nextNextTileX = ghost.nextTileX;
+                    ghost.nextNextTileY = ghost.nextTileY - 1;
+                    LOG_MESSAGE(LOG_LEVEL_DEBUG, "up");
+                }
+            }
+        }
+        else if (directions[i] == down) {
+            if (grid[ghost.nextTileY + 1][ghost.nextTileX] == 1) {
+                float dist = Distance(CalculatePositionBasedOnTile(ghost.nextTileY + 1, ghost.nextTileX, cellSize), targetPosition);
+                if (dist < minDistance) {
+                    minDistance = dist;
+                    ghost.pendingDirection = down;
+                    ghost.nextNextTileX = ghost.nextTileX;
+                    ghost.nextNextTileY = ghost.nextTileY + 1;
+                    LOG_MESSAGE(LOG_LEVEL_DEBUG, "down");
+                }
+            }
+        }
+    }
+}
+
+// Turns exactly on the pending tile's centre, which Simulation::Step() always lands on; a
+// looser test would let a short step turn early and leave the ghost off its lane //
+void UpdateGhost(Ghost &ghost, float deltaTime, float cellSize, const MazeBitboard &board) {
+    if (fabsf(ghost.pendingPosition.x - ghost.centroid.x) < SWEEP_EPSILON && fabsf(ghost.pendingPosition.y - ghost.centroid.y) < SWEEP_EPSILON) {
+        if (IsTraversable(ghost, ghost.pendingDirection, deltaTime, cellSize, board)) {
+            MoveActor(ghost, ghost.pendingDirection, deltaTime, cellSize);
+            ghost.pendingDirection = none;
+            ghost.nextTileX = ghost.nextNextTileX;
+            ghost.nextTileY = ghost.nextNextTileY;
+            ghost.pendingPosition = CalculatePositionBasedOnTile(ghost.nextTileY, ghost.nextTileX, cellSize);
+        }
+        else if (IsTraversable(ghost, ghost.orientation, deltaTime, cellSize, board))
+            MoveActor(ghost, ghost.orientation, deltaTime, cellSize);
+    }
+    else if (IsTraversable(ghost, ghost.orientation, deltaTime, cellSize, board))
+        MoveActor(ghost, ghost.orientation, deltaTime, cellSize);
+}
+
+bool GhostRoster::Add(GhostPersonalityId id, int row, int column, Orientation heading, float cellSize) {
+    if (count >= ROSTER_CAPACITY)
+        return false;
+    const GhostPersonality &p = GHOST_PERSONALITIES[id];
+    int slot = count++;
+    int stepX = heading != none ? MazeTablesDetail::STEP_X[heading] : 0;
+    int stepY = heading != none ? MazeTablesDetail::STEP_Y[heading] : 0;
+
+    Vector2 centre = CalculatePositionBasedOnTile(row, column, cellSize);
+    Vector2 next = CalculatePositionBasedOnTile(row + stepY, column + stepX, cellSize);
+    centroidX[slot] = centre.x;
+    centroidY[slot] = centre.y;
+    currentTileX[slot] = column;
+    currentTileY[slot] = row;
+    orientation[slot] = heading;
+    nextTileX[slot] = column + stepX;
+    nextTileY[slot] = row + stepY;
+    nextNextTileX[slot] = nextTileX[slot];
+    nextNextTileY[slot] = nextTileY[slot];
+    pendingPositionX[slot] = next.x;
+    pendingPositionY[slot] = next.y;
+    pendingDirection[slot] = none;
+    targetTileX[slot] = p.scatterTileX;
+    targetTileY[slot] = p.scatterTileY;
+
+    personality[slot] = id;
+    scatterTileX[slot] = p.scatterTileX;
+    scatterTileY[slot] = p.scatterTileY;
+    lead[slot] = p.lead;
+    pivotScale[slot] = p.pivotScale;
+    pivot[slot] = p.pivot <= slot ? p.pivot : slot;     // a missing pivot ghost falls back to itself
+    shyRadiusSquared[slot] = p.shyRadius * p.shyRadius;
+    return true;
+}
+
+// A roster and a view onto one name their columns alike, so one copy serves both //
+template <typename Ghosts>
+static void LoadGhost(const Ghosts &ghosts, int slot, Ghost &ghost, float cellSize) {
+    ghost.centroid = Vector2{ghosts.centroidX[slot], ghosts.centroidY[slot]};
+    ghost.width = cellSize;
+    ghost.height = cellSize;
+    ghost.currentTileX = ghosts.currentTileX[slot];
+    ghost.currentTileY = ghosts.currentTileY[slot];
+    ghost.orientation = ghosts.orientation[slot];
+    ghost.speed = ghosts.speed;
+    ghost.nextTileX = ghosts.nextTileX[slot];
+    ghost.nextTileY = ghosts.nextTileY[slot];
+    ghost.nextNextTileX = ghosts.nextNextTileX[slot];
+    ghost.nextNextTileY = ghosts.nextNextTileY[slot];
+    ghost.pendingPosition = Vector2{ghosts.pendingPositionX[slot], ghosts.pendingPositionY[slot]};
+    ghost.pendingDirection = ghosts.pendingDirection[slot];
+    ghost.targetTileX = ghosts.targetTileX[slot];
+    ghost.targetTileY = ghosts.targetTileY[slot];
+}
+
+template <typename Ghosts>
+static void StoreGhost(Ghosts &ghosts, int slot, const Ghost &ghost) {
+    ghosts.centroidX[slot] = ghost.centroid.x;
+    ghosts.centroidY[slot] = ghost.centroid.y;
+    ghosts.currentTileX[slot] = ghost.currentTileX;
+    ghosts.currentTileY[slot] = ghost.currentTileY;
+    ghosts.orientation[slot] = ghost.orientation;
+    ghosts.nextTileX[slot] = ghost.nextTileX;
+    ghosts.nextTileY[slot] = ghost.nextTileY;
+    ghosts.nextNextTileX[slot] = ghost.nextNextTileX;
+    ghosts.nextNextTileY[slot] = ghost.nextNextTileY;
+    ghosts.pendingPositionX[slot] = ghost.pendingPosition.x;
+    ghosts.pendingPositionY[slot] = ghost.pendingPosition.y;
+    ghosts.pendingDirection[slot] = ghost.pendingDirection;
+    ghosts.targetTileX[slot] = ghost.targetTileX;
+    ghosts.targetTileY[slot] = ghost.targetTileY;
+}
+
+void GhostRoster::Load(int slot, Ghost &ghost, float cellSize) const {
+    LoadGhost(*this, slot, ghost, cellSize);
+}
+
+void GhostRoster::Store(int slot, const Ghost &ghost) {
+    StoreGhost(*this, slot, ghost);
+}
+
+GhostColumns GhostRoster::Columns() {
+    return GhostColumns{count, speed, centroidX, centroidY, currentTileX, currentTileY, orientation, nextTileX, nextTileY, nextNextTileX, nextNextTileY,
+        pendingPositionX, pendingPositionY, pendingDirection, targetTileX, targetTileY, personality, scatterTileX, scatterTileY, lead, pivotScale, pivot, shyRadiusSquared};
+}
+
+void GhostColumns::Load(int slot, Ghost &ghost, float cellSize) const {
+    LoadGhost(*this, slot, ghost, cellSize);
+}
+
+void GhostColumns::Store(int slot, const Ghost &ghost) {
+    StoreGhost(*this, slot, ghost);
+}
+
+// The tile a point heading that way is in or, within SWEEP_EPSILON of the edge ahead, about to
+// enter. A segment that ends on an edge hands the next one the tile beyond it either way //
+static inline Coordinate LeadingTile(float x, float y, Orientation heading, float cellSize) {
+    float stepX = (float)((heading == right) - (heading == left));
+    float stepY = (float)((heading == down) - (heading == up));
+    return Coordinate{(int)floorf((x + stepX * SWEEP_EPSILON - MAZE_ORIGIN_X) / cellSize), (int)floorf((y + stepY * SWEEP_EPSILON - MAZE_ORIGIN_Y) / cellSize)};
+}
+
+// What every ghost's target is worked out from over one segment //
+typedef struct TargetInputs {
+    int playerX;
+    int playerY;
+    int headingX;
+    int headingY;
+    int scattering;                         // all ones or all zeros
+    int wandering;
+    unsigned int seed;
+    int pivotX[ROSTER_CAPACITY];            // each ghost's pivot ghost's tile
+    int pivotY[ROSTER_CAPACITY];
+} TargetInputs;
+
+// Every rule is computed for every ghost and masks pick between them, so there are no
+// branches for the vectoriser to trip over //
+static inline void TargetGhost(const GhostColumns &ghosts, const TargetInputs &in, int i, int *targetTileX, int *targetTileY) {
+    int aheadX = in.playerX + in.headingX * ghosts.lead[i];
+    int aheadY = in.playerY + in.headingY * ghosts.lead[i];
+    int chaseX = ghosts.pivotScale[i] * aheadX - (ghosts.pivotScale[i] - 1) * in.pivotX[i];
+    int chaseY = ghosts.pivotScale[i] * aheadY - (ghosts.pivotScale[i] - 1) * in.pivotY[i];
+
+    // shyness is judged from the tile the ghost next picks a direction on //
+    int dx = ghosts.nextTileX[i] - in.playerX;
+    int dy = ghosts.nextTileY[i] - in.playerY;
+    int home = in.scattering | -(int)(dx * dx + dy * dy < ghosts.shyRadiusSquared[i]);
+
+    // frightened ghosts wander towards a fresh random tile //
+    unsigned int noise = (in.seed + i) * 2246822519u;
+    noise ^= noise >> 15;
+    int randomX = (int)(noise % NUM_TILES_HORIZONTAL);
+    int randomY = (int)((noise >> 16) % NUM_TILES_VERTICAL);
+
+    int targetX = (ghosts.scatterTileX[i] & home) | (chaseX & ~home);
+    int targetY = (ghosts.scatterTileY[i] & home) | (chaseY & ~home);
+    targetTileX[i] = (randomX & in.wandering) | (targetX & ~in.wandering);
+    targetTileY[i] = (randomY & in.wandering) | (targetY & ~in.wandering);
+}
+
+void UpdateGhostTargets(GhostColumns &ghosts, const Actor &player, GhostState state, unsigned long long tick, float cellSize) {
+    TargetInputs in;
+    Coordinate tile = LeadingTile(player.centroid.x, player.centroid.y, player.orientation, cellSize);
+    in.playerX = tile.x;
+    in.playerY = tile.y;
+    in.headingX = MazeTablesDetail::LEAD_X[player.orientation];
+    in.headingY = MazeTablesDetail::LEAD_Y[player.orientation];
+    in.scattering = -(int)(state == scatter);
+    in.wandering = -(int)(state == frightened);
+    in.seed = (unsigned int)tick * 2654435761u;
+
+    // the pivots are gathered up front so the passes below only read column i //
+    for (int i = 0; i < ghosts.count; i++) {
+        int p = ghosts.pivot[i];
+        tile = ghosts.pivotScale[i] != 1 ? LeadingTile(ghosts.centroidX[p], ghosts.centroidY[p], ghosts.orientation[p], cellSize) : Coordinate{0, 0};
+        in.pivotX[i] = tile.x;
+        in.pivotY[i] = tile.y;
+    }
+
+    // -O2 only vectorises a loop with no scalar leftovers, so whole blocks go first. They
+    // write to locals, which can't alias the columns they read, and are copied out after //
+    int targetTileX[ROSTER_CAPACITY];
+    int targetTileY[ROSTER_CAPACITY];
+    int i = 0;
+    for (; i + TARGET_BLOCK <= ghosts.count; i += TARGET_BLOCK)
+        for (int j = 0; j < TARGET_BLOCK; j++)
+            TargetGhost(ghosts, in, i + j, targetTileX, targetTileY);
+    for (; i < ghosts.count; i++)
+        TargetGhost(ghosts, in, i, targetTileX, targetTileY);
+    std::copy(targetTileX, targetTileX + ghosts.count, ghosts.targetTileX);
+    std::copy(targetTileY, targetTileY + ghosts.count, ghosts.targetTileY);
+}
+
+// preferred if it's open, otherwise the tile's first exit //
+static Orientation OpenHeading(const MazeBitboard &board, int row, int column, Orientation preferred) {
+    uint8_t exits = board.LegalMoves(row, column);
+    if (preferred != none && (exits >> preferred) & 1)
+        return preferred;
+    return exits != 0 ? (Orientation)__builtin_ctz(exits) : none;
+}
+
+// The n-th spawn for a ghost without one of its own: walkable tiles SPAWN_STRIDE apart in
+// reading order, skipping the player's start, heading out of the tile's first exit //
+static void SpreadSpawn(const MazeBitboard &board, Coordinate playerStart, int n, int &row, int &column, Orientation &heading) {
+    int walkable = 0;
+    for (int i = 0; i < NUM_TILES_VERTICAL; i++)
+        for (int j = 0; j < NUM_TILES_HORIZONTAL; j++)
+            walkable += board.IsWalkable(i, j) && board.LegalMoves(i, j) != 0 && !(i == playerStart.y && j == playerStart.x);
+
+    int pick = walkable > 0 ? (int)(((long long)(n + 1) * SPAWN_STRIDE) % walkable) : 0;
+    for (int i = 0; i < NUM_TILES_VERTICAL; i++) {
+        for (int j = 0; j < NUM_TILES_HORIZONTAL; j++) {
+            uint8_t exits = board.LegalMoves(i, j);
+            if (!board.IsWalkable(i, j) || exits == 0 || (i == playerStart.y && j == playerStart.x) || pick-- > 0)
+                continue;
+            row = i;
+            column = j;
+            heading = (Orientation)__builtin_ctz(exits);
+            return;
+        }
+    }
+}
+
+void Simulation::Reset() {
+    Reset(DEFAULT_ROSTER, sizeof(DEFAULT_ROSTER) / sizeof(DEFAULT_ROSTER[0]));
+}
+
+void Simulation::Reset(const GhostPersonalityId *roster, int count) {
+    cellSize = CELL_SIZE;
+    tick = 0;
+    caughtBy = NO_COLLISION;
+
+    // Initialize Player //
+    Coordinate start = layout->playerSpawns[0];
+    player.centroid = CalculatePositionBasedOnTile(start.y, start.x, cellSize);
+    player.width = cellSize;
+    player.height = cellSize;
+    player.currentTileX = start.x;
+    player.currentTileY = start.y;
+    player.orientation = left;
+    player.speed = ACTOR_SPEED;
+
+    // Initialize Ghosts //
+    // a maze with spawns of its own hands them out by slot; the table's starts only suit the
+    // stock maze //
+    ghosts.Clear();
+    ghosts.speed = ACTOR_SPEED;
+    bool placed[NUM_PERSONALITIES] = {};
+    for (int i = 0, repeats = 0; i < count; i++) {
+        const GhostPersonality &p = GHOST_PERSONALITIES[roster[i]];
+        int row = p.startRow;
+        int column = p.startColumn;
+        Orientation heading = p.startOrientation;
+        if (i < layout->numGhostSpawns) {
+            row = layout->ghostSpawns[i].y;
+            column = layout->ghostSpawns[i].x;
+            heading = OpenHeading(*board, row, column, p.startOrientation);
+        }
+        else if (placed[roster[i]] || layout->numGhostSpawns > 0)
+            SpreadSpawn(*board, start, repeats++, row, column, heading);
+        placed[roster[i]] = true;
+        if (!ghosts.Add(roster[i], row, column, heading, cellSize)) {
+            LogMessage(LOG_LEVEL_WARNING, "SIMULATION: Roster is full, dropped %d of %d ghosts", count - i, count);
+            break;
+        }
+    }
+
+    // Initialize AI //
+    modePhase = 0;
+    modeTime = GHOST_MODE_SCHEDULE[0].seconds;
+    frightenedTime = 0;
+    ghostState = GHOST_MODE_SCHEDULE[0].state;
+}
+
+void Simulation::Frighten(float seconds) {
+    frightenedTime = seconds;
+    ghostState = frightened;
+}
+
+void Simulation::UseMaze(const Maze &maze) {
+    grid = &maze.grid;
+    routes = &maze.routes;
+    board = &maze.board;
+    layout = &maze.layout;
+}
+
+// How far an actor heading in orientation travels before it next reaches a tile centre, which
+// is where every turn and wall stop is decided. On a centre already, that's the next one //
+static float DistanceToCentre(const Actor &actor, Orientation orientation, float cellSize) {
+    if (orientation == none)
+        return std::numeric_limits<float>::max();
+    bool horizontal = orientation == left || orientation == right;
+    float position = horizontal ? actor.centroid.x - MAZE_ORIGIN_X : actor.centroid.y - MAZE_ORIGIN_Y;
+    float pastCentre = position - (floorf(position / cellSize) + 0.5f) * cellSize;
+    float distance = (orientation == right || orientation == down) ? -pastCentre : pastCentre;
+    return distance > 0 ? distance : distance + cellSize;
+}
+
+// Shortens segmentTime so the actor stops on the next centre ahead rather than passing it //
+static void ClampToCentre(const Actor &actor, Orientation orientation, float cellSize, float &segmentTime) {
+    float distance = DistanceToCentre(actor, orientation, cellSize);
+    if (distance < actor.speed * segmentTime)
+        segmentTime = distance / actor.speed;
+}
+
+// How far a point heading in orientation travels before it crosses into the next tile. Within
+// SWEEP_EPSILON of that edge it already counts as across, as LeadingTile() has it //
+static float DistanceToEdge(float x, float y, Orientation orientation, float cellSize) {
+    if (orientation == none)
+        return std::numeric_limits<float>::max();
+    bool horizontal = orientation == left || orientation == right;
+    float position = horizontal ? x - MAZE_ORIGIN_X : y - MAZE_ORIGIN_Y;
+    float intoTile = position - floorf(position / cellSize) * cellSize;
+    float distance = (orientation == right || orientation == down) ? cellSize - intoTile : intoTile;
+    return distance > SWEEP_EPSILON ? distance : distance + cellSize;
+}
+
+// The distinct roster slots some ghost pivots on, which ClampToTargetTiles() watches //
+static int FindPivots(const GhostColumns &ghosts, int *pivots) {
+    uint64_t seen[ROSTER_CAPACITY / 64] = {};
+    int count = 0;
+    for (int i = 0; i < ghosts.count; i++) {
+        int p = ghosts.pivot[i];
+        if (ghosts.pivotScale[i] == 1 || (seen[p / 64] >> (p % 64)) & 1)
+            continue;
+        seen[p / 64] |= 1ull << (p % 64);
+        pivots[count++] = p;
+    }
+    return count;
+}
+
+// Shortens segmentTime so that nothing a ghost targets from changes tile part way through: not
+// the player, whichever way it goes, and not any of the pivots. A pivot that reaches a tunnel
+// mouth's centre is carried off there, so that ends the segment too //
+static void ClampToTargetTiles(const Simulation &sim, const GhostColumns &ghosts, Orientation action, const int *pivots, int numPivots, float &segmentTime) {
+    const Actor &player = sim.player;
+    float reach = player.speed * segmentTime;
+    reach = fminf(reach, DistanceToEdge(player.centroid.x, player.centroid.y, player.orientation, sim.cellSize));
+    if (action != player.orientation)
+        reach = fminf(reach, DistanceToEdge(player.centroid.x, player.centroid.y, action, sim.cellSize));
+    if (reach < player.speed * segmentTime)
+        segmentTime = reach / player.speed;
+
+    if (ghosts.speed <= 0)
+        return;
+    reach = ghosts.speed * segmentTime;
+    for (int i = 0; i < numPivots; i++) {
+        int p = pivots[i];
+        Orientation heading = ghosts.orientation[p];
+        reach = fminf(reach, DistanceToEdge(ghosts.centroidX[p], ghosts.centroidY[p], heading, sim.cellSize));
+
+        int row = ghosts.nextTileY[p];
+        int column = ghosts.nextTileX[p];
+        if (sim.layout->numTunnels > 0 && (unsigned)row < NUM_TILES_VERTICAL && (unsigned)column < NUM_TILES_HORIZONTAL && sim.layout->tunnelAt[row][column] != 0) {
+            Vector2 mouth = CalculatePositionBasedOnTile(row, column, sim.cellSize);
+            float distance = fabsf(mouth.x - ghosts.centroidX[p]) + fabsf(mouth.y - ghosts.centroidY[p]);
+            if (distance > SWEEP_EPSILON)
+                reach = fminf(reach, distance);
+        }
+    }
+    if (reach < ghosts.speed * segmentTime)
+        segmentTime = reach / ghosts.speed;
+}
+
+// Removes the rounding left by a segment that ended on, or a hair short of, a centre //
+static void SnapToCentre(Actor &actor, float cellSize) {
+    Vector2 centre = CalculatePositionBasedOnTile(actor.currentTileY, actor.currentTileX, cellSize);
+    if (fabsf(actor.centroid.x - centre.x) < SWEEP_EPSILON)
+        actor.centroid.x = centre.x;
+    if (fabsf(actor.centroid.y - centre.y) < SWEEP_EPSILON)
+        actor.centroid.y = centre.y;
+}
+
+// The tunnel mouth whose centre the actor stands on, or NULL //
+static const MazeTunnel *TunnelAt(const Simulation &sim, const Actor &actor) {
+    int row = actor.currentTileY;
+    int column = actor.currentTileX;
+    if ((unsigned)row >= NUM_TILES_VERTICAL || (unsigned)column >= NUM_TILES_HORIZONTAL || sim.layout->tunnelAt[row][column] == 0)
+        return NULL;
+    Vector2 centre = CalculatePositionBasedOnTile(row, column, sim.cellSize);
+    if (actor.centroid.x != centre.x || actor.centroid.y != centre.y)
+        return NULL;
+    return &sim.layout->tunnels[sim.layout->tunnelAt[row][column] - 1];
+}
+
+// Carries an actor from a mouth's centre to its partner's, heading back into the maze //
+static void ThroughTunnel(const Simulation &sim, Actor &actor, const MazeTunnel &mouth) {
+    const MazeTunnel &exit = sim.layout->tunnels[mouth.partner];
+    actor.centroid = CalculatePositionBasedOnTile(exit.row, exit.column, sim.cellSize);
+    actor.currentTileX = exit.column;
+    actor.currentTileY = exit.row;
+    actor.orientation = MazeTablesDetail::OPPOSITE[exit.outward];
+}
+
+static void ChooseDirection(const Simulation &sim, Ghost &ghost) {
+    if (sim.routes != NULL)
+        ChooseGhostDirection(ghost, *sim.routes);
+    else
+        ChooseGhostDirection(ghost, sim.cellSize, *sim.grid);
+}
+
+// Moves one ghost on through time, split at each tile centre it reaches so it turns exactly
+// where it should. The next tile's direction is picked the moment it turns rather than at the
+// start of whatever segment follows //
+static void SweepGhost(const Simulation &sim, Ghost &ghost, float time) {
+    if (ghost.pendingDirection == none)
+        ChooseDirection(sim, ghost);
+    for (bool first = true; first || time * ghost.speed > SWEEP_EPSILON; first = false) {
+        float segmentTime = time;
+        ClampToCentre(ghost, ghost.orientation, sim.cellSize, segmentTime);
+        UpdateGhost(ghost, segmentTime, sim.cellSize, *sim.board);
+        SnapToCentre(ghost, sim.cellSize);
+
+        // the routes lead through tunnels, so a ghost headed out of a mouth takes it and
+        // picks its way on from the far side //
+        const MazeTunnel *mouth = TunnelAt(sim, ghost);
+        if (mouth != NULL && (ghost.orientation == mouth->outward || ghost.pendingDirection == mouth->outward)) {
+            ThroughTunnel(sim, ghost, *mouth);
+            ghost.nextTileX = ghost.currentTileX + MazeTablesDetail::STEP_X[ghost.orientation];
+            ghost.nextTileY = ghost.currentTileY + MazeTablesDetail::STEP_Y[ghost.orientation];
+            ghost.pendingPosition = CalculatePositionBasedOnTile(ghost.nextTileY, ghost.nextTileX, sim.cellSize);
+            ghost.pendingDirection = none;
+        }
+        if (ghost.pendingDirection == none)
+            ChooseDirection(sim, ghost);
+        time -= segmentTime;
+    }
+}
+
+// Seconds until the ghosts' mode next changes //
+static float ModeTimeLeft(const Simulation &sim) {
+    if (sim.frightenedTime > 0)
+        return sim.frightenedTime;
+    return GHOST_MODE_SCHEDULE[sim.modePhase].seconds > 0 ? sim.modeTime : std::numeric_limits<float>::max();
+}
+
+static void AdvanceMode(Simulation &sim, float elapsed) {
+    if (sim.frightenedTime > 0) {
+        sim.frightenedTime -= elapsed;
+        if (sim.frightenedTime <= 0) {
+            sim.frightenedTime = 0;
+            sim.ghostState = GHOST_MODE_SCHEDULE[sim.modePhase].state;
+        }
+        return;
+    }
+    if (GHOST_MODE_SCHEDULE[sim.modePhase].seconds <= 0)
+        return;
+    sim.modeTime -= elapsed;
+    if (sim.modeTime <= 0 && sim.modePhase + 1 < NUM_MODE_PHASES) {
+        sim.modePhase++;
+        sim.modeTime = GHOST_MODE_SCHEDULE[sim.modePhase].seconds;
+        sim.ghostState = GHOST_MODE_SCHEDULE[sim.modePhase].state;
+    }
+}
+
+// Profiler ticks spent in each phase over a whole Step(), which adds them to the profiler once
+// at the end for its owner to Flush() //
+typedef struct StepTimes {
+    uint64_t player;
+    uint64_t ai;
+} StepTimes;
+
+// One segment of a step: the player never passes a tile centre part way through, and each
+// ghost sweeps its own centres against targets that hold for the whole segment //
+static void Advance(Simulation &sim, GhostColumns &ghosts, Orientation action, float deltaTime, StepTimes &times) {
+    bool timing = sim.profiler != NULL;
+    uint64_t playerStart = timing ? ProfilerNow() : 0;
+    Actor from = sim.player;
+    {
+        UpdatePlayer(sim.player, action, deltaTime, sim.cellSize, *sim.board);
+        from.orientation = sim.player.orientation;
+        SnapToCentre(sim.player, sim.cellSize);
+
+        // into a tunnel when asked to, or when carrying on is all the player would do //
+        Actor &player = sim.player;
+        const MazeTunnel *mouth = TunnelAt(sim, player);
+        if (mouth != NULL) {
+            bool turning = (sim.board->LegalMoves(player.currentTileY, player.currentTileX) >> action) & 1;
+            if (action == mouth->outward || (player.orientation == mouth->outward && !turning))
+                ThroughTunnel(sim, player, *mouth);
+        }
+    }
+
+    uint64_t aiStart = timing ? ProfilerNow() : 0;
+    UpdateGhostTargets(ghosts, from, sim.ghostState, sim.tick, sim.cellSize);
+    Ghost ghost;
+    for (int i = 0; i < ghosts.count; i++) {
+        ghosts.Load(i, ghost, sim.cellSize);
+        SweepGhost(sim, ghost, deltaTime);
+        ghosts.Store(i, ghost);
+    }
+    if (timing) {
+        times.player += aiStart - playerStart;
+        times.ai += ProfilerNow() - aiStart;
+    }
+}
+
+void Simulation::Step(Orientation action, float deltaTime) {
+    GhostColumns columns = ghosts.Columns();
+    StepSimulation(*this, columns, action, deltaTime);
+}
+
+void StepSimulation(Simulation &sim, GhostColumns &ghosts, Orientation action, float deltaTime) {
+    // Movement is only ever checked against the tile a single move lands in, so a long move
+    // would carry an actor straight past a junction or a ghost's turn. Splitting the step at
+    // every tile centre an actor reaches makes one long step land exactly where the same time
+    // in short steps does, whatever deltaTime a hitch, fast-forward or training run uses.
+    // Ghosts split their own share (see SweepGhost()) so a crowded maze doesn't cut the step
+    // into one segment per ghost centre; the player's centres and mode changes cut it here.
+    // Targets are taken once per segment, so the segment also ends wherever the player or a
+    // pivot ghost moves into another tile, and a ghost shies away by the tile it will next
+    // turn on; chase then turns ghosts the same way at any deltaTime, as scatter does. Only
+    // frightened ghosts, which draw a random target per Step(), still depend on it.
+    // A leftover too short to move anyone SWEEP_EPSILON is rounding, and is dropped rather than
+    // being allowed to turn an actor that has only just arrived on a centre.
+    // Collisions are checked after every segment (see CollisionIndex.h), and no segment is
+    // longer than a ghost takes to cross one tile, so none can slip past a player that is
+    // standing still.
+    // However long deltaTime is, the loop runs until all of it is simulated; every segment
+    // reaches at least a centre, an edge or a mode change. remaining is a double so a step of
+    // hours still counts down by segments a fraction of a second long //
+    float fastest = sim.player.speed > ghosts.speed ? sim.player.speed : ghosts.speed;
+    double remaining = deltaTime;
+    if (!isfinite(deltaTime) || deltaTime < 0) {
+        LOG_MESSAGE(LOG_LEVEL_WARNING, "SIMULATION: Ignoring a step of %f seconds", deltaTime);
+        remaining = 0;
+    }
+    static thread_local CollisionIndex collisions;
+    int pivots[ROSTER_CAPACITY];
+    int numPivots = FindPivots(ghosts, pivots);
+    StepTimes times = {};
+    while (remaining * fastest > SWEEP_EPSILON) {
+        // the player can reverse anywhere and head for the centre behind it //
+        float segmentTime = (float)remaining;
+        ClampToCentre(sim.player, sim.player.orientation, sim.cellSize, segmentTime);
+        if (action != sim.player.orientation)
+            ClampToCentre(sim.player, action, sim.cellSize, segmentTime);
+        ClampToTargetTiles(sim, ghosts, action, pivots, numPivots, segmentTime);
+        segmentTime = fminf(segmentTime, ModeTimeLeft(sim));
+        if (ghosts.speed > 0)
+            segmentTime = fminf(segmentTime, sim.cellSize / ghosts.speed);
+        if (!(segmentTime > 0)) {
+            LOG_MESSAGE(LOG_LEVEL_WARNING, "SIMULATION: Step stalled with %.6f of %.6f seconds unsimulated", remaining, deltaTime);
+            break;
+        }
+
+        int playerFrom = CollisionCell(sim.player.currentTileY, sim.player.currentTileX);
+        collisions.Begin(ghosts);
+        Advance(sim, ghosts, action, segmentTime, times);
+        AdvanceMode(sim, segmentTime);
+
+        // frightened ghosts are harmless; eating them isn't modelled yet //
+        collisions.Build(ghosts);
+        int touching = collisions.Find(playerFrom, CollisionCell(sim.player.currentTileY, sim.player.currentTileX));
+        if (touching != NO_COLLISION && sim.ghostState != frightened && sim.caughtBy == NO_COLLISION)
+            sim.caughtBy = touching;
+        remaining -= segmentTime;
+    }
+
+    if (sim.profiler != NULL) {
+        sim.profiler->Add(PHASE_PLAYER, ProfilerTicksToNanoseconds(times.player));
+        sim.profiler->Add(PHASE_AI, ProfilerTicksToNanoseconds(times.ai));
+    }
+    sim.tick++;
+}
@@ -0,0 +1,319 @@
+/*******************************************************************************************
+*
+*   PacAI simulation core
+*
+*   Grid, actor state, movement and ghost targeting with no rendering dependency, so the
+*   game can be stepped headless at whatever rate the host allows.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#define MAZE_ORIGIN_X 50
+#define MAZE_ORIGIN_Y 50
+#define MAZE_SCALE 2
+#define PIXELS_PER_TILE 8
+#define CELL_SIZE (PIXELS_PER_TILE * MAZE_SCALE)
+#define NUM_TILES_HORIZONTAL 28
+#define NUM_TILES_VERTICAL 31
+#define STARTING_ROW 23
+#define STARTING_COLUMN 13
+#define BLINKY_STARTING_ROW 11
+#define BLINKY_STARTING_COLUMN 13
+#define ACTOR_SPEED 100
+#define SWEEP_EPSILON 0.01f                 // pixels; nearer than this to a tile centre counts as on it
+#define ROSTER_CAPACITY 256                 // ghosts one game can hold
+#define NUM_MODE_PHASES 8
+#define MAX_SPAWNS ROSTER_CAPACITY
+#define MAX_TUNNEL_MOUTHS 52                // a to z, one pair each
+#define NO_COLLISION -1
+
+#include <stddef.h>
+
+// raylib declares the same Vector2 layout; share it when the renderer is in the build //
+#if !defined(RL_VECTOR2_TYPE)
+typedef struct Vector2 {
+    float x;
+    float y;
+} Vector2;
+#define RL_VECTOR2_TYPE
+#endif
+
+typedef enum Orientation {
+    up,
+    down,
+    left,
+    right,
+    none
+} Orientation;
+
+typedef enum GhostState {
+    chase,
+    scatter,
+    frightened,
+} GhostState;
+
+typedef struct Actor {
+    Vector2 centroid;
+    int width;
+    int height;
+    int currentTileX;
+    int currentTileY;
+    Orientation orientation;
+    float speed;
+} Actor;
+
+typedef struct Ghost : Actor {
+    int nextTileX;
+    int nextTileY;
+    int nextNextTileX;
+    int nextNextTileY;
+    Vector2 pendingPosition;
+    Orientation pendingDirection;
+    int targetTileX;
+    int targetTileY;
+} Ghost;
+
+// Who a ghost is. How it targets and where it scatters to are entries in GHOST_PERSONALITIES,
+// so a new kind of ghost is a new row there rather than new code //
+typedef enum GhostPersonalityId {
+    BLINKY,
+    PINKY,
+    INKY,
+    CLYDE,
+    AMBUSHER,
+    FLANKER,
+    NUM_PERSONALITIES
+} GhostPersonalityId;
+
+// In chase a ghost aims at pivotScale * (the player's tile + lead tiles ahead of it) -
+// (pivotScale - 1) * the pivot ghost's tile. That one formula covers Blinky (lead 0), Pinky
+// (lead 4) and Inky (lead 2, reflected through Blinky). A ghost closer to the player than
+// shyRadius tiles heads for its scatter corner instead, which is Clyde //
+typedef struct GhostPersonality {
+    const char *name;
+    int scatterTileX;
+    int scatterTileY;
+    int lead;
+    int pivotScale;
+    int pivot;                              // roster slot
+    int shyRadius;                          // 0 never shies away
+    int startRow;
+    int startColumn;
+    Orientation startOrientation;
+} GhostPersonality;
+
+extern const GhostPersonality GHOST_PERSONALITIES[NUM_PERSONALITIES];
+
+// Scatter and chase alternate on the arcade's first level timings; the last phase never ends //
+typedef struct GhostModePhase {
+    GhostState state;
+    float seconds;
+} GhostModePhase;
+
+extern const GhostModePhase GHOST_MODE_SCHEDULE[NUM_MODE_PHASES];
+
+// One game's ghosts as pointers into columns kept elsewhere: a GhostRoster's own arrays, or
+// one game's run in BatchSimulation's. Simulation::Step() works through one of these, so the
+// same rules run on either in place. Movement gathers a ghost into a Ghost so it can reuse the
+// Actor rules; targeting runs straight down the columns in UpdateGhostTargets() //
+typedef struct GhostColumns {
+    int count;
+    float speed;
+
+    float *centroidX;
+    float *centroidY;
+    int *currentTileX;
+    int *currentTileY;
+    Orientation *orientation;
+    int *nextTileX;
+    int *nextTileY;
+    int *nextNextTileX;
+    int *nextNextTileY;
+    float *pendingPositionX;
+    float *pendingPositionY;
+    Orientation *pendingDirection;
+    int *targetTileX;
+    int *targetTileY;
+
+    const int *personality;
+    const int *scatterTileX;
+    const int *scatterTileY;
+    const int *lead;
+    const int *pivotScale;
+    const int *pivot;
+    const int *shyRadiusSquared;
+
+    void Load(int slot, Ghost &ghost, float cellSize) const;
+    void Store(int slot, const Ghost &ghost);
+} GhostColumns;
+
+// Every ghost in a game, one array per field //
+typedef struct GhostRoster {
+    int count;
+    float speed;
+
+    float centroidX[ROSTER_CAPACITY];
+    float centroidY[ROSTER_CAPACITY];
+    int currentTileX[ROSTER_CAPACITY];
+    int currentTileY[ROSTER_CAPACITY];
+    Orientation orientation[ROSTER_CAPACITY];
+    int nextTileX[ROSTER_CAPACITY];
+    int nextTileY[ROSTER_CAPACITY];
+    int nextNextTileX[ROSTER_CAPACITY];
+    int nextNextTileY[ROSTER_CAPACITY];
+    float pendingPositionX[ROSTER_CAPACITY];
+    float pendingPositionY[ROSTER_CAPACITY];
+    Orientation pendingDirection[ROSTER_CAPACITY];
+    int targetTileX[ROSTER_CAPACITY];
+    int targetTileY[ROSTER_CAPACITY];
+
+    // copied out of GHOST_PERSONALITIES by Add() //
+    int personality[ROSTER_CAPACITY];
+    int scatterTileX[ROSTER_CAPACITY];
+    int scatterTileY[ROSTER_CAPACITY];
+    int lead[ROSTER_CAPACITY];
+    int pivotScale[ROSTER_CAPACITY];
+    int pivot[ROSTER_CAPACITY];
+    int shyRadiusSquared[ROSTER_CAPACITY];
+
+    void Clear() { count = 0; }
+    // false once the roster is full; row, column + orientation must be walkable //
+    bool Add(GhostPersonalityId id, int row, int column, Orientation heading, float cellSize);
+    void Load(int slot, Ghost &ghost, float cellSize) const;
+    void Store(int slot, const Ghost &ghost);
+    GhostColumns Columns();
+} GhostRoster;
+
+typedef struct Coordinate {
+    int x;
+    int y;
+} Coordinate;
+
+typedef int Grid[NUM_TILES_VERTICAL][NUM_TILES_HORIZONTAL];
+
+// One end of a tunnel. An actor leaving the maze edge outward here comes back in at partner //
+typedef struct MazeTunnel {
+    int row;
+    int column;
+    Orientation outward;
+    int partner;                            // index into MazeLayout::tunnels
+} MazeTunnel;
+
+// Everything about a maze besides its walls: where actors start and which edge tiles wrap
+// round. Mazes smaller than the grid sit in its top-left corner, walled in. See MazeFile.h //
+typedef struct MazeLayout {
+    int rows;
+    int columns;
+    int numPlayerSpawns;
+    Coordinate playerSpawns[MAX_SPAWNS];
+    int numGhostSpawns;                     // 0 starts ghosts where GHOST_PERSONALITIES says
+    Coordinate ghostSpawns[MAX_SPAWNS];     // by roster slot
+    int numTunnels;
+    MazeTunnel tunnels[MAX_TUNNEL_MOUTHS];
+    unsigned char tunnelAt[NUM_TILES_VERTICAL][NUM_TILES_HORIZONTAL];   // 1 + index into tunnels, 0 for none
+} MazeLayout;
+
+extern const MazeLayout DEFAULT_LAYOUT;    // DEFAULT_GRID's, with no tunnels
+
+// The stock maze; 1 marks a walkable tile. constexpr so derived tables can be built at compile time //
+inline constexpr Grid DEFAULT_GRID = {
+    {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+    {0,1,1,1,1,1,1,1,1,1,1,1,1,0,0,1,1,1,1,1,1,1,1,1,1,1,1,0},
+    {0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0},
+    {0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0},
+    {0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0},
+    {0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0},
+    {0,1,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,1,0},
+    {0,1,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,1,0},
+    {0,1,1,1,1,1,1,0,0,1,1,1,1,0,0,1,1,1,1,0,0,1,1,1,1,1,1,0},
+    {0,0,0,0,0,0,1,0,0,0,0,0,1,0,0,1,0,0,0,0,0,1,0,0,0,0,0,0},
+    {0,0,0,0,0,0,1,0,0,0,0,0,1,0,0,1,0,0,0,0,0,1,0,0,0,0,0,0},
+    {0,0,0,0,0,0,1,0,0,1,1,1,1,1,1,1,1,1,1,0,0,1,0,0,0,0,0,0},
+    {0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0},
+    {0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0},
+    {1,1,1,1,1,1,1,1,1,1,0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,1,1},
+    {0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0},
+    {0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0},
+    {0,0,0,0,0,0,1,0,0,1,1,1,1,1,1,1,1,1,1,0,0,1,0,0,0,0,0,0},
+    {0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0},
+    {0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0},
+    {0,1,1,1,1,1,1,1,1,1,1,1,1,0,0,1,1,1,1,1,1,1,1,1,1,1,1,0},
+    {0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0},
+    {0,1,0,0,0,0,1,0,0,0,0,0,1,0,0,1,0,0,0,0,0,1,0,0,0,0,1,0},
+    {0,1,1,1,0,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,0,1,1,1,0},
+    {0,0,0,1,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,1,0,0,0},
+    {0,0,0,1,0,0,1,0,0,1,0,0,0,0,0,0,0,0,1,0,0,1,0,0,1,0,0,0},
+    {0,1,1,1,1,1,1,0,0,1,1,1,1,0,0,1,1,1,1,0,0,1,1,1,1,1,1,0},
+    {0,1,0,0,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,0,0,1,0},
+    {0,1,0,0,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,0,0,0,0,0,0,1,0},
+    {0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0},
+    {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0}
+};
+
+Vector2 CalculatePositionBasedOnTile(int row, int column, float cellSize);
+void SetCurrentTileForActor(Actor &actor, float cellSize);
+bool IsTraversable(const Actor &actor, Orientation direction, float deltaTime, float cellSize, const int (&grid)[NUM_TILES_VERTICAL][NUM_TILES_HORIZONTAL]);
+void MoveActor(Actor &actor, Orientation orientation, float deltaTime, float cellSize);
+bool IsReversal(Orientation actorDirection, Orientation newDirection);
+
+// All-pairs routing tables for a grid, see MazeTables.h //
+struct MazeRoutes;
+extern const MazeRoutes DEFAULT_MAZE_ROUTES;
+
+// Packed copy of a grid for the movement checks, see Bitboard.h //
+struct MazeBitboard;
+extern const MazeBitboard DEFAULT_BITBOARD;
+
+// Per-phase timing, see Profiler.h //
+struct Profiler;
+
+// A maze loaded from a file along with its tables, see MazeFile.h //
+struct Maze;
+
+// Per-frame behaviour, shared by the windowed game and the headless runner //
+void UpdatePlayer(Actor &player, Orientation input, float deltaTime, float cellSize, const MazeBitboard &board);
+void ChooseGhostDirection(Ghost &ghost, float cellSize, const Grid &grid);
+void UpdateGhost(Ghost &ghost, float deltaTime, float cellSize, const MazeBitboard &board);
+
+// Rewrites every ghost's target tile for the current mode in one branch-free pass. player is
+// where the player starts the stretch of time the targets are for, facing the way it moves //
+void UpdateGhostTargets(GhostColumns &ghosts, const Actor &player, GhostState state, unsigned long long tick, float cellSize);
+
+// One complete game. Reset() restores the starting positions, Step() advances a single tick
+// of any length; see Step() for how long ticks stay exact //
+typedef struct Simulation {
+    const Grid *grid = &DEFAULT_GRID;
+    const MazeRoutes *routes = &DEFAULT_MAZE_ROUTES;    // NULL falls back to straight-line targeting
+    const MazeBitboard *board = &DEFAULT_BITBOARD;      // must describe the same maze as grid
+    const MazeLayout *layout = &DEFAULT_LAYOUT;         // and this too
+    float cellSize;
+    Actor player;
+    GhostRoster ghosts;
+    GhostState ghostState;
+    int modePhase;                                      // into GHOST_MODE_SCHEDULE
+    float modeTime;                                     // seconds left in it
+    float frightenedTime;                               // while above 0 ghosts are frightened and the schedule waits
+    unsigned long long tick;
+    int caughtBy;                                       // roster slot of the first ghost to catch the player, NO_COLLISION until then
+    Profiler *profiler = NULL;                          // when set, Step() Add()s its player and AI time; the owner Flush()es
+
+    // The first ghost of each personality starts where the table says; repeats are spread
+    // over the rest of the maze //
+    void Reset();                                       // Blinky, Pinky, Inky and Clyde
+    void Reset(const GhostPersonalityId *roster, int count);
+    void Step(Orientation action, float deltaTime);
+    void Frighten(float seconds);
+
+    // Points every maze table at one loaded maze; Reset() afterwards to use its spawns //
+    void UseMaze(const Maze &maze);
+} Simulation;
+
+// Simulation::Step() for a game whose ghosts live in ghosts rather than sim.ghosts, which is
+// left alone. BatchSimulation steps its games in place in its own columns this way //
+void StepSimulation(Simulation &sim, GhostColumns &ghosts, Orientation action, float deltaTime);
+
+#endif
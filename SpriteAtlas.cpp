@@ -0,0 +1,51 @@
+/*******************************************************************************************
+*
+*   PacAI sprite atlas
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "SpriteAtlas.h"
+#include <stddef.h>
+
+const char *SPRITE_PATHS[SPRITE_COUNT] = {
+    "resources/pacman.png",
+    "resources/blinky.png",
+};
+
+void SpriteAtlas::Load() {
+    // One shelf is plenty for a handful of small sprites //
+    Image images[SPRITE_COUNT];
+    int width = 0;
+    int height = 0;
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        images[i] = LoadImage(SPRITE_PATHS[i]);
+        width += images[i].width + ATLAS_PADDING;
+        height = images[i].height > height ? images[i].height : height;
+    }
+
+    Image atlas = GenImageColor(width > 0 ? width : 1, height > 0 ? height : 1, BLANK);
+    int x = 0;
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        Rectangle source = Rectangle{0, 0, (float)images[i].width, (float)images[i].height};
+        frames[i] = Rectangle{(float)x, 0, source.width, source.height};
+        if (images[i].data != NULL)
+            ImageDraw(&atlas, images[i], source, frames[i], WHITE);
+        x += images[i].width + ATLAS_PADDING;
+        UnloadImage(images[i]);
+    }
+
+    texture = LoadTextureFromImage(atlas);
+    UnloadImage(atlas);
+}
+
+void SpriteAtlas::Unload() {
+    UnloadTexture(texture);
+}
+
+void SpriteAtlas::Draw(SpriteId sprite, Vector2 centre, float scale, Color tint) const {
+    Vector2 size = Size(sprite, scale);
+    Rectangle destination = Rectangle{centre.x - size.x / 2, centre.y - size.y / 2, size.x, size.y};
+    DrawTexturePro(texture, frames[sprite], destination, Vector2{0, 0}, 0, tint);
+}
@@ -0,0 +1,42 @@
+/*******************************************************************************************
+*
+*   PacAI sprite atlas
+*
+*   Every actor sprite packed side by side into one texture. raylib batches consecutive
+*   draws that share a texture, so drawing all actors of all visible games through the
+*   atlas, with nothing else in between, costs a single draw call.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef SPRITE_ATLAS_H
+#define SPRITE_ATLAS_H
+
+#include "raylib.h"
+
+#define ATLAS_PADDING 1                     // blank pixels between sprites so filtering can't bleed
+
+typedef enum SpriteId {
+    SPRITE_PACMAN,
+    SPRITE_BLINKY,
+    SPRITE_COUNT
+} SpriteId;
+
+extern const char *SPRITE_PATHS[SPRITE_COUNT];
+
+typedef struct SpriteAtlas {
+    Texture2D texture;
+    Rectangle frames[SPRITE_COUNT];         // source rectangles; empty for images that failed to load
+
+    void Load();
+    void Unload();
+
+    // Size in screen pixels at the given scale //
+    Vector2 Size(SpriteId sprite, float scale) const { return Vector2{frames[sprite].width * scale, frames[sprite].height * scale}; }
+
+    // Draws the sprite centred on centre //
+    void Draw(SpriteId sprite, Vector2 centre, float scale, Color tint) const;
+} SpriteAtlas;
+
+#endif
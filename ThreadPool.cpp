@@ -0,0 +1,103 @@
+/*******************************************************************************************
+*
+*   PacAI thread pool
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int numThreads) : ranges(std::max(1, numThreads > 0 ? numThreads : (int)std::thread::hardware_concurrency())) {
+    numWorkers = (int)ranges.size();
+    job = NULL;
+    grain = 1;
+    pending = 0;
+    generation = 0;
+    stopping = false;
+
+    // worker 0 is whoever calls ParallelFor //
+    for (int i = 1; i < numWorkers; i++)
+        threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+void ThreadPool::ParallelFor(int count, int grain, const RangeJob &job) {
+    if (count <= 0)
+        return;
+    grain = std::max(1, grain);
+
+    // small batches aren't worth waking anyone up for //
+    if (numWorkers == 1 || count <= grain) {
+        for (int begin = 0; begin < count; begin += grain)
+            job(begin, std::min(begin + grain, count));
+        return;
+    }
+
+    // hand every worker an equal contiguous slice to start from //
+    int perWorker = (count + numWorkers - 1) / numWorkers;
+    for (int i = 0; i < numWorkers; i++) {
+        int begin = std::min(i * perWorker, count);
+        ranges[i].next.store(begin, std::memory_order_relaxed);
+        ranges[i].end = std::min(begin + perWorker, count);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->job = &job;
+        this->grain = grain;
+        pending = numWorkers - 1;
+        generation++;
+    }
+    wake.notify_all();
+
+    RunRanges(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return pending == 0; });
+    this->job = NULL;
+}
+
+void ThreadPool::WorkerLoop(int index) {
+    unsigned long long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+
+        RunRanges(index);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending--;
+        }
+        done.notify_one();
+    }
+}
+
+void ThreadPool::RunRanges(int self) {
+    // own slice first, then steal from the others in turn //
+    for (int k = 0; k < numWorkers; k++) {
+        WorkerRange &range = ranges[(self + k) % numWorkers];
+        for (;;) {
+            int begin = range.next.fetch_add(grain, std::memory_order_relaxed);
+            if (begin >= range.end)
+                break;
+            (*job)(begin, std::min(begin + grain, range.end));
+        }
+    }
+}
@@ -0,0 +1,60 @@
+/*******************************************************************************************
+*
+*   PacAI thread pool
+*
+*   Persistent workers that split a parallel-for into one contiguous range per worker.
+*   A worker drains its own range first and then steals chunks from the others, so uneven
+*   chunks (games that hit more decisions) still balance out across cores.
+*
+*   Copyright (c) 2021 Steven Hyde
+*
+********************************************************************************************/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define CACHE_LINE_SIZE 64
+
+typedef std::function<void(int begin, int end)> RangeJob;
+
+typedef struct ThreadPool {
+    // numThreads counts the calling thread; 0 picks one per hardware thread //
+    explicit ThreadPool(int numThreads = 0);
+    ~ThreadPool();
+
+    int Size() const { return numWorkers; }
+
+    // Runs job over [0, count) in chunks of at most grain items and returns once all are done //
+    void ParallelFor(int count, int grain, const RangeJob &job);
+
+private:
+    struct alignas(CACHE_LINE_SIZE) WorkerRange {
+        std::atomic<int> next;
+        int end;
+    };
+
+    void WorkerLoop(int index);
+    void RunRanges(int self);
+
+    int numWorkers;
+    std::vector<std::thread> threads;
+    std::vector<WorkerRange> ranges;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const RangeJob *job;
+    int grain;
+    int pending;
+    unsigned long long generation;
+    bool stopping;
+} ThreadPool;
+
+#endif